@@ -2,12 +2,13 @@
 #define ADC_H
 
 #include <avr/io.h>
+#include "clock.h"
 
 // --- ADC Initialization ---
 static inline void adc_init(void)
 {
     ADMUX = (1 << ADLAR);  // Left adjust, VCC reference
-    ADCSRA = (1 << ADEN) | (1 << ADPS2) | (1 << ADPS1);  // Enable, prescaler 64
+    ADCSRA = (1 << ADEN) | ADC_PS_BITS;  // Enable, 125kHz ADC clock
 }
 
 // --- ADC Read (8-bit) ---
@@ -0,0 +1,47 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <avr/io.h>
+
+// --- Clock Profiles (make CLOCK=8 / CLOCK=16) ---
+// 8MHz:  internal RC oscillator, lfuse 0xE2
+// 16MHz: 64MHz PLL / 4 as system clock, lfuse 0xE1 (needs VCC >= 4.5V)
+// Every prescaler and compare value below is derived from F_CPU so the
+// ADC, PWM and tick rates are the same on both profiles; only the number
+// of CPU cycles per period changes.
+
+#if F_CPU != 8000000UL && F_CPU != 16000000UL
+#error "clock.h: F_CPU must be 8000000UL or 16000000UL"
+#endif
+
+// === ADC (125kHz ADC clock, 104us per conversion) ===
+#define ADC_CLOCK_HZ 125000UL
+#if F_CPU == 8000000UL
+#define ADC_PRESCALER 64
+#define ADC_PS_BITS ((1 << ADPS2) | (1 << ADPS1))
+#else
+#define ADC_PRESCALER 128
+#define ADC_PS_BITS ((1 << ADPS2) | (1 << ADPS1) | (1 << ADPS0))
+#endif
+
+// === Timer1 System-Clock PWM (sequencer CV/LED, 31.25kHz) ===
+#define PWM_HZ 31250UL
+#if F_CPU == 8000000UL
+#define PWM_PRESCALER 1
+#define PWM_CS_BITS (1 << CS10)
+#else
+#define PWM_PRESCALER 2
+#define PWM_CS_BITS (1 << CS11)
+#endif
+
+// === Timer0 1ms Tick (sequencer) ===
+#define TICK_PRESCALER 64
+#define TICK_CS_BITS ((1 << CS01) | (1 << CS00))
+#define TICK_OCR (F_CPU / TICK_PRESCALER / 1000 - 1)  // 8MHz: 124, 16MHz: 249
+
+_Static_assert(F_CPU / ADC_PRESCALER == ADC_CLOCK_HZ, "ADC clock must be 125kHz");
+_Static_assert(F_CPU / PWM_PRESCALER / 256 == PWM_HZ, "Timer1 PWM must be 31.25kHz");
+_Static_assert(F_CPU % (TICK_PRESCALER * 1000UL) == 0, "1ms tick must be exact");
+_Static_assert(TICK_OCR <= 255, "1ms tick does not fit Timer0");
+
+#endif // CLOCK_H
@@ -0,0 +1,124 @@
+#ifndef INSTRUMENT_H
+#define INSTRUMENT_H
+
+#include <stdint.h>
+
+// --- Runtime Instrumentation (build with `make INSTRUMENT=1`) ---
+// Both chips run Timer0 in CTC mode, so TCNT0 restarts at every compare match
+// and reads as "timer ticks since this period began". The entry stamp is the
+// latency; exit minus entry is the duration. No other timer is needed.
+// Results live in `instr` so a debugger or simulator can read them by symbol.
+
+#ifdef INSTRUMENT
+
+#include <avr/io.h>
+
+#define INSTR_STACK_PAINT 0xC5  // Fill pattern for unused stack
+#define INSTR_STACK_MARGIN 32   // Less free stack than this counts as a warning
+
+typedef struct {
+    uint8_t tick_cycles;   // CPU cycles per Timer0 tick (prescaler)
+    uint8_t period;        // Timer0 ticks per ISR period (OCR0A + 1)
+    uint8_t entry;         // This call's entry stamp (ticks after compare match)
+    uint8_t entry_late;    // This call was entered a full period late
+    uint8_t entry_max;     // Worst entry stamp (ticks after compare match)
+    uint8_t isr_last;      // Last ISR duration, entry to exit (ticks, saturates at 255)
+    uint8_t isr_max;       // Worst ISR duration, entry to exit (ticks, saturates at 255)
+    uint8_t load_peak;     // isr_max / period scaled to 0-255 (main loop)
+    uint16_t isr_avg;      // Average duration over last 256 calls (ticks * 256)
+    uint16_t overruns;     // ISR still running when the next compare match hit
+                           // (not counted for a late call, already in missed)
+    uint16_t missed;       // ISR entered a full period late (interrupts were off)
+    uint16_t stack_free;   // Bytes of stack never touched since reset
+    uint16_t window_sum;   // Running sum for isr_avg
+    uint8_t window_count;  // Calls in current window (wraps at 256)
+} instr_t;
+
+volatile instr_t instr;
+
+// Paint the stack before main() runs; instr_poll() counts what is left.
+extern uint8_t _end;
+extern uint8_t __stack;
+void instr_paint_stack(void) __attribute__((naked, used, section(".init3")));
+void instr_paint_stack(void)
+{
+    uint8_t *p = &_end;
+    while (p <= &__stack)
+        *p++ = INSTR_STACK_PAINT;
+}
+
+// Call once after Timer0 is configured
+static inline void instr_init(uint8_t tick_cycles)
+{
+    instr.tick_cycles = tick_cycles;
+    instr.period = OCR0A + 1;
+}
+
+static inline void instr_isr_enter(void)
+{
+    uint8_t entry = TCNT0;
+    instr.entry = entry;
+    // Vectoring cleared OCF0A; set again means a whole period went by
+    instr.entry_late = TIFR & (1 << OCF0A);
+    if (instr.entry_late)
+        instr.missed++;
+    if (entry > instr.entry_max)
+        instr.entry_max = entry;
+}
+
+static inline void instr_isr_exit(void)
+{
+    uint8_t now = TCNT0;
+    uint16_t dur = now;
+    if (instr.entry_late) {
+        // OCF0A is still the late period's: only a wrap shows a later match
+        if (now < instr.entry)
+            dur += instr.period;
+    } else if (TIFR & (1 << OCF0A)) {
+        instr.overruns++;
+        dur += instr.period;
+    }
+    dur -= instr.entry;
+    if (dur > 255) dur = 255;
+    instr.isr_last = dur;
+    if (dur > instr.isr_max)
+        instr.isr_max = dur;
+
+    instr.window_sum += dur;
+    if (++instr.window_count == 0) {
+        instr.isr_avg = instr.window_sum;
+        instr.window_sum = 0;
+    }
+}
+
+#define INSTR_ISR_ENTER() instr_isr_enter()
+#define INSTR_ISR_EXIT() instr_isr_exit()
+
+// Main loop housekeeping: stack high-water scan and peak load (0-255)
+static inline void instr_poll(void)
+{
+    const uint8_t *p = &_end;
+    while (p <= &__stack && *p == INSTR_STACK_PAINT)
+        p++;
+    instr.stack_free = p - &_end;
+
+    uint16_t peak = (uint16_t)instr.isr_max * 255 / instr.period;
+    instr.load_peak = (peak > 255) ? 255 : peak;
+}
+
+// Nonzero when the unit has overrun, missed a tick or nearly hit the stack
+static inline uint8_t instr_warning(void)
+{
+    return instr.overruns || instr.missed || instr.stack_free < INSTR_STACK_MARGIN;
+}
+
+#else
+
+#define INSTR_ISR_ENTER() ((void)0)
+#define INSTR_ISR_EXIT() ((void)0)
+static inline void instr_init(uint8_t tick_cycles) { (void)tick_cycles; }
+static inline void instr_poll(void) {}
+
+#endif // INSTRUMENT
+
+#endif // INSTRUMENT_H
@@ -0,0 +1,146 @@
+#ifndef BANKS_H
+#define BANKS_H
+
+#include <stdint.h>
+
+// --- Pattern Banks in EEPROM ---
+// A pattern is two 16-step bars. Each bank stores two 1-byte bar ids, and
+// each distinct bar is stored once in a dictionary that fills the rest of
+// the EEPROM. Banks that share a bar (an empty bar, a groove copied to
+// several banks, the same bar twice) share its two bytes. An erased
+// byte (0xFF) is the empty bar, so a blank chip needs no formatting.
+//
+// Loading a bank is six byte reads whatever the store holds, so a bank
+// switch always lands on the downbeat. Saving one scans the ids and the
+// dictionary: an entry that already holds the bar is reused, even one no
+// bank refers to any more; otherwise the bar goes to the next unreferenced
+// entry (round robin, spreading wear). At most 6 bytes are written. The
+// cursor is not stored: bank_init_cursor() picks it up again at boot.
+//
+// Up to BANK_GUARANTEED (78) banks, every bank can hold two distinct bars,
+// with room for a bank's new bars beside its old ones. Above that, a save
+// can find the dictionary full; the pattern then stays in SRAM as unsaved
+// and the save is retried at the next bar.
+
+#ifndef BANK_COUNT
+#define BANK_COUNT 64
+#endif
+
+#define EEPROM_SIZE 512            // ATtiny85
+#define BANK_IDS_BASE 0x26         // 2 ids per bank, bar 1 first (above the old layout, main.c)
+#define BANK_DICT_BASE (BANK_IDS_BASE + 2 * BANK_COUNT)
+#define BANK_DICT_SIZE ((EEPROM_SIZE - BANK_DICT_BASE) / 2)  // Entries, 2 bytes each
+#define BANK_GUARANTEED ((EEPROM_SIZE - BANK_IDS_BASE - 4) / 6)
+#define BANK_BAR_EMPTY 0xFF
+#define BANK_ID_ADDR(bank, bar) ((uint8_t*)(BANK_IDS_BASE + (bank) * 2 + (bar)))
+#define BANK_ENTRY_ADDR(id) ((uint8_t*)(BANK_DICT_BASE + (id) * 2))
+
+_Static_assert(BANK_COUNT >= 2 && BANK_COUNT < 0xFF, "BANK_COUNT: 2-254 (0xFF = no pending bank)");
+_Static_assert(BANK_DICT_SIZE >= 2, "BANK_COUNT leaves no room for bars");
+_Static_assert(BANK_DICT_SIZE <= BANK_BAR_EMPTY, "Bar ids are one byte, 0xFF = empty");
+
+static uint8_t bank_next_entry = 0;  // Round-robin allocation cursor
+
+// Mark the entries any bank refers to
+static void bank_mark_used(uint8_t *used)
+{
+    for (uint8_t i = 0; i < (BANK_DICT_SIZE + 7) / 8; i++)
+        used[i] = 0;
+    for (uint8_t b = 0; b < BANK_COUNT; b++) {
+        for (uint8_t h = 0; h < 2; h++) {
+            uint8_t id = eeprom_read_byte(BANK_ID_ADDR(b, h));
+            if (id < BANK_DICT_SIZE)
+                used[id >> 3] |= 1 << (id & 7);
+        }
+    }
+}
+
+static inline uint16_t bank_read_bar(uint8_t id)
+{
+    if (id >= BANK_DICT_SIZE)
+        return 0;  // Empty (or out of range)
+    uint8_t *p = BANK_ENTRY_ADDR(id);
+    return eeprom_read_byte(p) | (uint16_t)eeprom_read_byte(p + 1) << 8;
+}
+
+// Pattern stored in a bank
+static uint32_t bank_load(uint8_t bank)
+{
+    uint16_t bar1 = bank_read_bar(eeprom_read_byte(BANK_ID_ADDR(bank, 0)));
+    uint16_t bar2 = bank_read_bar(eeprom_read_byte(BANK_ID_ADDR(bank, 1)));
+    return bar1 | (uint32_t)bar2 << 16;
+}
+
+// Store a pattern in a bank; returns 0 if the dictionary is full (the bank
+// keeps its previous pattern)
+static uint8_t bank_save(uint8_t bank, uint32_t pattern)
+{
+    // Entries any bank refers to, this one included: a bar is never
+    // rewritten while referenced, so a failed or interrupted save leaves
+    // the old pattern intact
+    uint8_t used[(BANK_DICT_SIZE + 7) / 8];
+    bank_mark_used(used);
+
+    uint8_t ids[2];
+    for (uint8_t h = 0; h < 2; h++) {
+        uint16_t bar = h ? pattern >> 16 : pattern;
+        uint8_t id = BANK_BAR_EMPTY;
+        if (bar) {
+            // Entry already holding the bar
+            for (id = 0; id < BANK_DICT_SIZE && bank_read_bar(id) != bar; id++);
+            if (id == BANK_DICT_SIZE) {
+                // Next free entry
+                uint8_t n;
+                id = bank_next_entry;
+                for (n = 0; n < BANK_DICT_SIZE && (used[id >> 3] & (1 << (id & 7))); n++)
+                    id = (id + 1 < BANK_DICT_SIZE) ? id + 1 : 0;
+                if (n == BANK_DICT_SIZE)
+                    return 0;
+                bank_next_entry = (id + 1 < BANK_DICT_SIZE) ? id + 1 : 0;
+                uint8_t *p = BANK_ENTRY_ADDR(id);
+                eeprom_update_byte(p, bar);
+                eeprom_update_byte(p + 1, bar >> 8);
+            }
+            used[id >> 3] |= 1 << (id & 7);  // Not free for the other bar
+        }
+        ids[h] = id;
+    }
+    eeprom_update_byte(BANK_ID_ADDR(bank, 0), ids[0]);
+    eeprom_update_byte(BANK_ID_ADDR(bank, 1), ids[1]);
+    return 1;
+}
+
+// Cursor at boot: the start of the longest run of unreferenced entries.
+// The entries just behind the cursor are the newest, the ones after it the
+// oldest and the likeliest to be free again, so the run starts about where
+// the last session's saves stopped, rather than at entry 0 every power-up.
+static void bank_init_cursor(void)
+{
+    uint8_t used[(BANK_DICT_SIZE + 7) / 8];
+    bank_mark_used(used);
+    uint8_t start = 0, len = 0, best_len = 0, id = 0;
+    // Twice round, so a run across the end counts whole
+    for (uint16_t n = 0; n < 2 * BANK_DICT_SIZE; n++) {
+        if (used[id >> 3] & (1 << (id & 7))) {
+            len = 0;
+        } else {
+            if (!len) start = id;
+            if (len < BANK_DICT_SIZE && ++len > best_len) {
+                best_len = len;
+                bank_next_entry = start;
+            }
+        }
+        id = (id + 1 < BANK_DICT_SIZE) ? id + 1 : 0;
+    }
+}
+
+// Empty every bank (ids only: erased ids already read as empty)
+static void bank_clear_all(void)
+{
+    for (uint8_t b = 0; b < BANK_COUNT; b++) {
+        eeprom_update_byte(BANK_ID_ADDR(b, 0), BANK_BAR_EMPTY);
+        eeprom_update_byte(BANK_ID_ADDR(b, 1), BANK_BAR_EMPTY);
+    }
+}
+
+#endif // BANKS_H
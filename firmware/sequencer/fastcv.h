@@ -0,0 +1,78 @@
+#ifndef FASTCV_H
+#define FASTCV_H
+
+#include <stdint.h>
+
+// --- Fast CV (build with `make FASTCV=1`) ---
+// Timer1 runs from the 64MHz PLL: 250kHz PWM instead of 31.25kHz, so the
+// CV filter can be 8x smaller for the same ripple. CV_RC_US is its R x C.
+// A rising CV edge is also pre-emphasized: OCR1B goes to full scale for as
+// long as the filter needs to reach the new level from the old one, then
+// to the level itself. That time is CV_RC_US * ln(255 / (255 - level)) -
+// the same for the old level, from a table in Timer0 counts (8us at 8MHz,
+// 4us at 16MHz); Timer0's compare B ends it. Falling edges already drive
+// the output to 0V and are written as they are.
+//
+// The old level is taken as settled. It is: the gate is 10ms and a step
+// is at least 62ms.
+
+#define CV_FULL 255
+
+#ifdef FASTCV
+
+#ifdef MIDI
+#error "MIDI needs Timer1 at 31.25kHz; FASTCV clocks it from the PLL"
+#endif
+
+#ifndef CV_RC_US
+#define CV_RC_US 220             // 10k x 22n: ~1 count of ripple at 250kHz
+#endif
+
+// Timer0 counts at full scale for 0 -> l; a table rather than a log at
+// run time. The compiler folds the logs.
+#define CV_EMPH_RAW(l) (CV_RC_US * __builtin_log(255.0 / (255 - (l) + ((l) == CV_FULL))) \
+                        / CV_EMPH_US + 0.5)
+#define CV_EMPH(l) ((l) == CV_FULL || CV_EMPH_RAW(l) > CV_EMPH_MAX ? CV_EMPH_MAX \
+                    : (uint8_t)CV_EMPH_RAW(l))
+#define CV_EMPH4(l) CV_EMPH(l), CV_EMPH(l + 1), CV_EMPH(l + 2), CV_EMPH(l + 3)
+#define CV_EMPH16(l) CV_EMPH4(l), CV_EMPH4(l + 4), CV_EMPH4(l + 8), CV_EMPH4(l + 12)
+#define CV_EMPH64(l) CV_EMPH16(l), CV_EMPH16(l + 16), CV_EMPH16(l + 32), CV_EMPH16(l + 48)
+
+static const uint8_t cv_emph_table[256] PROGMEM = {
+    CV_EMPH64(0), CV_EMPH64(64), CV_EMPH64(128), CV_EMPH64(192)
+};
+
+uint8_t cv_level = 0;            // Last level set
+volatile uint8_t cv_target = 0;  // Level at the end of the emphasis
+
+// Set the CV level (interrupts off)
+static inline void cv_set(uint8_t level)
+{
+    cv_emph_stop();
+    uint8_t from = cv_level;
+    cv_level = level;
+    if (level > from) {
+        uint8_t n = pgm_read_byte(&cv_emph_table[level]) - pgm_read_byte(&cv_emph_table[from]);
+        if (n) {
+            cv_target = level;
+            CV_PWM = CV_FULL;
+            if (cv_emph_start(n)) return;
+        }
+    }
+    CV_PWM = level;
+}
+
+// End of the emphasis
+ISR(CV_EMPH_vect)
+{
+    cv_emph_stop();
+    CV_PWM = cv_target;
+}
+
+#else
+
+static inline void cv_set(uint8_t level) { CV_PWM = level; }
+
+#endif // FASTCV
+
+#endif // FASTCV_H
@@ -0,0 +1,133 @@
+#ifndef HARDWARE_H
+#define HARDWARE_H
+
+// --- Hardware Abstraction ---
+// main.c reaches the chip only through this header: the LED/CV PWM outputs,
+// read_adc(), the EEPROM API, ISR()/sei()/cli(), setup_hardware(), the
+// MIDI bit clock and shift register (midi.h) and the CV emphasis timer
+// (fastcv.h).
+// Building with HOST_SIM swaps in the native simulator (../sim/host.h).
+
+#ifdef HOST_SIM
+#include "../sim/host.h"
+#else
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/eeprom.h>
+#include <avr/pgmspace.h>
+#include <util/delay.h>
+#include "../common/clock.h"
+#include "../common/adc.h"
+
+// --- Pin Configuration ---
+// PB0: I2C SDA (future) / trace output (TRACE=1) / MIDI out (MIDI=1)
+// PB1: LED output
+// PB2: I2C SCL (future)
+// PB3: Button input (ADC3)
+// PB4: CV output (OC1B PWM)
+#define LED_PIN PB1
+#define BTN_PIN PB3
+#define BTN_CH 3
+#define CV_PIN PB4
+
+// --- PWM Outputs ---
+#define LED_PWM OCR1A
+#define CV_PWM OCR1B
+
+// --- Hardware Setup (interrupts stay off) ---
+static inline void setup_hardware(void)
+{
+    // Timer1: PWM for CV on PB4 (OC1B) and LED on PB1 (OC1A)
+#ifdef FASTCV
+    // 64MHz PLL -> 250kHz (with CLOCK=16 the PLL is already running). It
+    // locks while the rest is set up; Timer1 moves onto it at the end.
+    PLLCSR |= (1 << PLLE);
+    TCCR1 = (1 << PWM1A) | (1 << COM1A1) | (1 << CS10); // PWM on OC1A, 250kHz
+#else
+    TCCR1 = (1 << PWM1A) | (1 << COM1A1) | PWM_CS_BITS; // PWM on OC1A, 31.25kHz
+#endif
+    GTCCR = (1 << PWM1B) | (1 << COM1B1);               // PWM on OC1B
+    OCR1A = 0;                                          // LED starts off
+    OCR1B = 0;                                          // CV starts at 0
+    OCR1C = 255;                                        // TOP
+
+    // Timer0: 1ms interrupt
+    TCCR0A = (1 << WGM01);
+    TCCR0B = TICK_CS_BITS;              // Prescaler 64
+    OCR0A = TICK_OCR;                   // F_CPU / 64 / (OCR0A + 1) = 1kHz
+    TIMSK |= (1 << OCIE0A);
+
+    // ADC
+    adc_init();
+
+    // GPIO
+    DDRB |= (1 << CV_PIN) | (1 << LED_PIN);
+
+#ifdef FASTCV
+    // PLL: 100us to settle, then wait for lock (the datasheet's procedure)
+#if F_CPU == 8000000UL
+    _delay_us(100);
+#endif
+    while (!(PLLCSR & (1 << PLOCK)));
+    PLLCSR |= (1 << PCKE);
+#endif
+}
+
+// --- MIDI Out on PB0 (MIDI=1, see midi.h) ---
+// USI in two-wire mode with software strobes; Timer1 overflow is the bit clock
+#define MIDI_PIN PB0
+#define MIDI_BITCLK_vect TIMER1_OVF_vect
+
+static inline void midi_usi_init(void)
+{
+    USIDR = 0xFF;                       // Line idle high
+    USICR = (1 << USIWM1);              // Two-wire mode, software clock strobe
+    PORTB |= (1 << MIDI_PIN);
+    DDRB |= (1 << MIDI_PIN);
+}
+
+static inline void midi_usi_load(uint8_t b) { USIDR = b; }
+static inline void midi_usi_shift(void) { USICR = (1 << USIWM1) | (1 << USICLK); }
+
+// Interrupts off (midi_put). Clearing the pending overflow first makes the
+// first bit cell a whole one.
+static inline void midi_bitclk_on(void)
+{
+    TIFR = (1 << TOV1);
+    TIMSK |= (1 << TOIE1);
+}
+
+static inline void midi_bitclk_off(void) { TIMSK &= ~(1 << TOIE1); }
+
+// --- CV Emphasis Timer (FASTCV=1, see fastcv.h) ---
+// Timer0 compare B, n counts from now; past the tick's TOP it wraps into
+// the next tick. Interrupts off. Returns 0 if TCNT0 reached the compare
+// point before OCR0B was written (small n at a fast prescaler): that
+// match is lost, and would otherwise only come a whole tick later, so the
+// caller ends the emphasis itself.
+#define CV_EMPH_vect TIMER0_COMPB_vect
+#define CV_EMPH_US (TICK_PRESCALER * 1000000.0 / F_CPU)
+#define CV_EMPH_MAX TICK_OCR
+
+static inline uint8_t cv_emph_start(uint8_t n)
+{
+    // Flag first: a match after the OCR0B write must stay pending
+    TIFR = (1 << OCF0B);
+    uint8_t t0 = TCNT0;
+    uint16_t at = t0 + n;
+    if (at > TICK_OCR) at -= TICK_OCR + 1;
+    OCR0B = at;
+    uint8_t t1 = TCNT0;
+    uint8_t gone = t1 - t0;
+    if (t1 < t0) gone += TICK_OCR + 1;
+    if (gone >= n) return 0;
+    TIMSK |= (1 << OCIE0B);
+    return 1;
+}
+
+static inline void cv_emph_stop(void) { TIMSK &= ~(1 << OCIE0B); }
+
+#endif // HOST_SIM
+
+#endif // HARDWARE_H
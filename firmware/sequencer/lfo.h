@@ -0,0 +1,126 @@
+#ifndef LFO_H
+#define LFO_H
+
+#include <stdint.h>
+
+// --- Accent LFO ---
+// The LFO is evaluated by the main loop, not the step ISR. At pattern start
+// (step 31→0) lfo_render() fills the back half of accent_table with the next
+// 32 accents and flips accent_bank; the ISR only indexes the front half.
+// Waveform cost never reaches the ISR, and rate/depth/waveform changes take
+// effect cleanly at the next bar.
+
+#define LFO_STEPS 32
+
+// === CV Accent Range ===
+// Floor stays well above the synth's trigger threshold (ADC 10, ~0.2V)
+#define CV_ACCENT_MAX 255
+#define CV_ACCENT_MIN 32
+
+// === Waveforms ===
+#define LFO_TRIANGLE 0
+#define LFO_SINE 1
+#define LFO_RANDOM 2  // Sample & hold, new value every LFO cycle
+#define LFO_WAVE_COUNT 3
+
+// === Rate (phase increment per step) ===
+#define LFO_RATE_COUNT 8
+#define LFO_RATE_DEFAULT 3  // One cycle per 32-step pattern
+static const uint16_t lfo_rate_inc[LFO_RATE_COUNT] = {
+    512,    // 128 steps
+    1024,   // 64 steps
+    1365,   // 48 steps
+    2048,   // 32 steps
+    2731,   // 24 steps
+    4096,   // 16 steps
+    8192,   // 8 steps
+    16384,  // 4 steps
+};
+
+// === Depth (0 = every trigger at full accent) ===
+#define LFO_DEPTH_MAX 8  // Depth 8 swings the accent down to CV_ACCENT_MIN
+#define LFO_DEPTH_DEFAULT 0
+
+volatile uint8_t lfo_wave = LFO_TRIANGLE;
+volatile uint8_t lfo_rate = LFO_RATE_DEFAULT;
+volatile uint8_t lfo_depth = LFO_DEPTH_DEFAULT;
+volatile uint8_t lfo_dirty = 0;  // Settings changed, needs save
+
+// === Accent Tables (front half read by the step ISR) ===
+uint8_t accent_table[2][LFO_STEPS];
+uint8_t lfo_high[2][LFO_STEPS / 8];  // Bit per step: LFO in upper half (LED)
+volatile uint8_t accent_bank = 0;
+
+static uint16_t lfo_phase = 0;
+static uint16_t lfo_seed = 0xACE1;
+static uint8_t lfo_hold = 255;  // Random: value held for the current cycle
+
+// Galois LFSR, same taps as the synth noise (8 shifts = fresh byte)
+static inline uint8_t lfo_random(void)
+{
+    for (uint8_t i = 0; i < 8; i++) {
+        uint8_t lsb = lfo_seed & 1;
+        lfo_seed >>= 1;
+        if (lsb) lfo_seed ^= 0xB400;
+    }
+    return lfo_seed;
+}
+
+// Raw waveform value (0-255) at a phase
+static inline uint8_t lfo_value(uint16_t phase)
+{
+    uint8_t t = phase >> 8;
+
+    switch (lfo_wave) {
+    case LFO_SINE: {
+        // Parabolic half-waves (within 6% of a sine), no table needed
+        uint8_t x = t & 0x7F;
+        uint8_t p = ((uint16_t)x * (128 - x)) >> 5;  // 0-128
+        if (p > 127) p = 127;
+        return (t & 0x80) ? 127 - p : 128 + p;
+    }
+    case LFO_RANDOM:
+        return lfo_hold;
+    default:
+        return (t & 0x80) ? (uint8_t)((255 - t) << 1) : (uint8_t)(t << 1);
+    }
+}
+
+// Render the next pattern's accents into the back half and flip
+static void lfo_render(void)
+{
+    uint8_t back = accent_bank ^ 1;
+    uint8_t *out = accent_table[back];
+    uint16_t inc = lfo_rate_inc[lfo_rate];
+    uint8_t depth = (lfo_depth >= LFO_DEPTH_MAX) ? 255 : (lfo_depth << 5);
+
+    for (uint8_t i = 0; i < LFO_STEPS; i++) {
+        uint8_t u = lfo_value(lfo_phase);
+        if ((i & 0x07) == 0) lfo_high[back][i >> 3] = 0;
+        if (u & 0x80) lfo_high[back][i >> 3] |= 1 << (i & 0x07);
+
+        // Depth scales the dip below full accent
+        uint8_t dip = ((uint16_t)(255 - u) * depth) >> 8;
+        out[i] = CV_ACCENT_MAX - (((uint16_t)dip * (CV_ACCENT_MAX - CV_ACCENT_MIN)) >> 8);
+
+        uint16_t next = lfo_phase + inc;
+        if (next < lfo_phase) lfo_hold = lfo_random();  // Cycle wrapped
+        lfo_phase = next;
+    }
+
+    __asm__ __volatile__ ("" ::: "memory");  // Table stores land before the flip
+    accent_bank = back;
+}
+
+// --- Step ISR Accessors ---
+static inline uint8_t lfo_accent(uint8_t step)
+{
+    return accent_table[accent_bank][step];
+}
+
+static inline uint8_t lfo_is_high(uint8_t step)
+{
+    return lfo_high[accent_bank][step >> 3] & (1 << (step & 0x07));  // WCET: 7
+}
+
+#endif // LFO_H
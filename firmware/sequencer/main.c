@@ -1,19 +1,10 @@
-#include <avr/io.h>
-#include <avr/interrupt.h>
-#include <avr/eeprom.h>
-#include <util/delay.h>
-#include "../common/adc.h"
-
-// === Pin Configuration ===
-// PB0: I2C SDA (future)
-// PB1: LED output
-// PB2: I2C SCL (future)
-// PB3: Button input (ADC3)
-// PB4: CV output (OC1B PWM)
-#define LED_PIN PB1
-#define BTN_PIN PB3
-#define BTN_CH 3
-#define CV_PIN PB4
+#include "hardware.h"
+#include "../common/instrument.h"
+#include "trace.h"
+#include "midi.h"
+#include "fastcv.h"
+#include "lfo.h"
+#include "banks.h"
 
 // === Button Thresholds (ADC 0-255) ===
 // Theoretical: A=0, B≈46, M≈85, None=255
@@ -51,9 +42,7 @@
 volatile uint8_t current_bpm = BPM_DEFAULT;
 volatile uint8_t bpm_dirty = 0;
 #define MS_PER_STEP() (60000UL / current_bpm / STEPS_PER_BEAT)
-
-// === CV Output ===
-#define CV_ACCENT 255 // Full accent for now (LFO later)
+_Static_assert(MIDI_CLOCKS_PER_STEP * STEPS_PER_BEAT == 24, "MIDI clock is 24 PPQN");
 
 // === LED Brightness ===
 #define LED_BAR_HEAD 255  // Bar start (step 0, 16): bright
@@ -63,6 +52,7 @@ volatile uint8_t bpm_dirty = 0;
 volatile uint32_t pattern = 0x00000000; // 32 steps, 1 bit each
 volatile uint8_t current_step = 0;
 volatile uint16_t tick_count = 0;
+volatile uint8_t ms_ticks = 0; // Free-running ms counter (main loop timing)
 volatile uint8_t step_triggered = 0; // Flag: step just changed
 volatile uint8_t current_btn = BTN_NONE; // Current button state (for ISR)
 volatile uint8_t pattern_dirty = 0; // Flag: pattern changed, needs save
@@ -71,28 +61,71 @@ volatile uint8_t pattern_dirty = 0; // Flag: pattern changed, needs save
 volatile uint8_t current_mode = MODE_PLAY;
 
 // === Bank ===
-#define BANK_COUNT 8
 #define BANK_NO_PENDING 0xFF
 volatile uint8_t current_bank = 0;
 volatile uint8_t pending_bank = BANK_NO_PENDING;  // Bank to switch at next bar
+uint32_t pending_pattern;  // Its pattern, loaded when scheduled
 
 // === EEPROM Layout ===
-// 0x00: Magic byte
+// 0x00: Magic byte (layout version)
 // 0x01: Current bank number
-// 0x02-0x21: 8 banks × 4 bytes = 32 bytes of patterns
-// 0x22: BPM
+// 0x02: BPM
+// 0x03-0x05: LFO waveform, rate, depth
+// 0x06: BANK_COUNT the banks were laid out for (banks.h moves with it)
+// 0x26-0x1FF: Pattern banks (banks.h)
 #define EEPROM_MAGIC_ADDR ((uint8_t*)0x00)
-#define EEPROM_MAGIC_VALUE 0xA5
+#define EEPROM_MAGIC_VALUE 0xA7
 #define EEPROM_BANK_ADDR ((uint8_t*)0x01)
-#define EEPROM_PATTERNS_BASE ((uint32_t*)0x02)
-#define EEPROM_PATTERN_ADDR(bank) ((uint32_t*)(0x02 + (bank) * 4))
-#define EEPROM_BPM_ADDR ((uint8_t*)0x22)
+#define EEPROM_BPM_ADDR ((uint8_t*)0x02)
+#define EEPROM_LFO_WAVE_ADDR ((uint8_t*)0x03)
+#define EEPROM_LFO_RATE_ADDR ((uint8_t*)0x04)
+#define EEPROM_LFO_DEPTH_ADDR ((uint8_t*)0x05)
+#define EEPROM_BANK_COUNT_ADDR ((uint8_t*)0x06)
+
+// Layout before banks.h (magic 0xA5): 8 banks as raw dwords at 0x02-0x21,
+// BPM at 0x22, LFO at 0x23-0x25. Converted once at boot (init_eeprom).
+// The banks start above it, so it stays readable until the banks are
+// saved; 0xA8 then marks the banks done and the header bytes (which
+// overlap the old patterns) still to write. A conversion cut short at any
+// point restarts from the step it was in.
+#define EEPROM_V1_MAGIC 0xA5
+#define EEPROM_V1_SAVED_MAGIC 0xA8
+#define EEPROM_V1_BANKS 8
+#define EEPROM_V1_PATTERN_ADDR(bank) ((uint32_t*)(0x02 + (bank) * 4))
+#define EEPROM_V1_BPM_ADDR ((uint8_t*)0x22)
 
 // === CV Auto-off Timing ===
 #define CV_GATE_MS 10
+volatile uint16_t cv_gate_end = CV_GATE_MS;  // tick_count that ends the gate
+
+// === Trigger Look-ahead (make CV_LOOKAHEAD=n) ===
+// Each step's CV goes out n ticks before its grid position, to cancel the
+// synth's response time (CV settling, polling, attack; see sim/latency.c).
+// The LED, MIDI clock, bar logic and live recording stay on the grid.
+#ifndef CV_LOOKAHEAD
+#define CV_LOOKAHEAD 0
+#endif
+_Static_assert(CV_LOOKAHEAD < CV_GATE_MS, "CV look-ahead must be shorter than the gate");
+volatile uint8_t cv_ahead = 0;  // CV of current_step already sent
+
+// === Live Recording (Play mode) ===
+// get_button() timestamps each new button state when the ADC first reads
+// it, before the debounce confirms it
+#define REC_NONE 0xFF
+volatile uint8_t rec_step = REC_NONE;  // Step to write and play when it fires
+uint8_t press_step;    // current_step at the press (the next step to fire)
+uint16_t press_tick;   // tick_count at the press (ms since the last step)
+// A press record_press() placed, while A stays down: the next step edge
+// does not write it again (a tap that outlasts the edge is one note), but
+// keeps the step. A still down at the edge after is a hold: the kept step
+// is written then, and every step after it as usual.
+#define HOLD_NONE 0xFF
+#define HOLD_PLACED 0xFE
+volatile uint8_t rec_hold = HOLD_NONE;  // Or the step the first edge kept
 
 // === Bank Switch ===
-// Schedule bank switch at next pattern start (step 0)
+// Schedule bank switch at next pattern start (step 0). The new pattern is
+// loaded now, so the switch itself is a copy.
 static void schedule_bank_switch(uint8_t new_bank)
 {
     if (new_bank >= BANK_COUNT) return;
@@ -100,6 +133,7 @@ static void schedule_bank_switch(uint8_t new_bank)
         pending_bank = BANK_NO_PENDING;  // Cancel pending switch
         return;
     }
+    pending_pattern = bank_load(new_bank);
     pending_bank = new_bank;
 }
 
@@ -112,15 +146,21 @@ static void apply_pending_bank(void)
         return;
     }
 
-    // Save current pattern to current bank
-    eeprom_update_dword(EEPROM_PATTERN_ADDR(current_bank), pattern);
+    // Save current pattern to current bank. With the bank store full
+    // (BANK_COUNT > BANK_GUARANTEED) the switch waits rather than drop it.
+    TRACE_EVENT(TR_EE_START, TR_EE_BANK);
+    if (pattern_dirty && !bank_save(current_bank, pattern)) {
+        TRACE_EVENT(TR_EE_END, TR_EE_BANK);
+        return;
+    }
 
-    // Load new bank's pattern
+    // Switch to the new bank's pattern (loaded when scheduled)
     current_bank = pending_bank;
-    pattern = eeprom_read_dword(EEPROM_PATTERN_ADDR(current_bank));
+    pattern = pending_pattern;
 
     // Save current bank number
     eeprom_update_byte(EEPROM_BANK_ADDR, current_bank);
+    TRACE_EVENT(TR_EE_END, TR_EE_BANK);
 
     pending_bank = BANK_NO_PENDING;
     pattern_dirty = 0;  // Just loaded, not dirty
@@ -133,44 +173,60 @@ static inline void update_led(uint8_t step)
     case MODE_PLAY:
         // Bar 2 beat 1: 8th note blink (steps 16,18 on / 17,19 off)
         if (step >= 16 && step < 20) {
-            OCR1A = (step & 0x01) ? 0 : LED_BAR_HEAD;
+            LED_PWM = (step & 0x01) ? 0 : LED_BAR_HEAD;
         } else if ((step & 0x03) != 0) {
-            OCR1A = 0;  // Non-beat steps: off
+            LED_PWM = 0;  // Non-beat steps: off
         } else if (step == 0) {
-            OCR1A = LED_BAR_HEAD;  // Bar 1 start: bright
+            LED_PWM = LED_BAR_HEAD;  // Bar 1 start: bright
         } else {
-            OCR1A = LED_BEAT;  // Other beats: dim
+            LED_PWM = LED_BEAT;  // Other beats: dim
         }
         break;
 
     case MODE_TEMPO:
         // Flash on every beat (steps 0,4,8,12,16,20,24,28)
-        OCR1A = ((step & 0x03) == 0) ? LED_BAR_HEAD : 0;
+        LED_PWM = ((step & 0x03) == 0) ? LED_BAR_HEAD : 0;
         break;
 
     case MODE_BANK:
         // Inverted pattern: bar head same, others inverted
         // Bar 2 beat 1: 8th note blink (same as Play)
         if (step >= 16 && step < 20) {
-            OCR1A = (step & 0x01) ? 0 : LED_BAR_HEAD;
+            LED_PWM = (step & 0x01) ? 0 : LED_BAR_HEAD;
         } else if ((step & 0x03) != 0) {
-            OCR1A = LED_BEAT;  // Non-beat steps: dim (inverted from Play)
+            LED_PWM = LED_BEAT;  // Non-beat steps: dim (inverted from Play)
         } else if (step == 0) {
-            OCR1A = LED_BAR_HEAD;  // Bar 1 start: bright (same as Play)
+            LED_PWM = LED_BAR_HEAD;  // Bar 1 start: bright (same as Play)
         } else {
-            OCR1A = 0;  // Other beats: off (inverted from Play)
+            LED_PWM = 0;  // Other beats: off (inverted from Play)
         }
         break;
 
     case MODE_LFO_RATE:
+        // Blink at LFO frequency: on while the LFO is in its upper half
+        LED_PWM = lfo_is_high(step) ? LED_BAR_HEAD : 0;
+        break;
+
     case MODE_LFO_DEPTH:
-        // TODO: LFO-based LED patterns
-        OCR1A = LED_BEAT;
+        // Brightness follows the accent each step would get
+        LED_PWM = lfo_accent(step);
         break;
 
     case MODE_ETC:
+#ifdef INSTRUMENT
+        // Instrumented build: fast blink on overrun/low stack,
+        // otherwise double blink with brightness = peak ISR load
+        if (instr_warning()) {
+            LED_PWM = (step & 0x01) ? 0 : LED_BAR_HEAD;
+        } else {
+            uint8_t level = instr.load_peak;
+            if (level < LED_BEAT) level = LED_BEAT;
+            LED_PWM = ((step & 0x03) < 2) ? level : 0;
+        }
+#else
         // Double blink pattern
-        OCR1A = ((step & 0x03) < 2) ? LED_BAR_HEAD : 0;
+        LED_PWM = ((step & 0x03) < 2) ? LED_BAR_HEAD : 0;
+#endif
         break;
     }
 }
@@ -182,41 +238,121 @@ static inline void update_cv(uint8_t step)
 
     // Pattern editing only in Play mode (blocked during pending bank switch)
     uint8_t can_edit = (current_mode == MODE_PLAY && pending_bank == BANK_NO_PENDING);
-    if (can_edit && current_btn == BTN_A) {
+    uint8_t held = can_edit && current_btn == BTN_A;
+    if (held && rec_hold != HOLD_NONE) {
+        if (rec_hold == HOLD_PLACED) {
+            rec_hold = step;  // Tap or hold: the next edge tells
+            held = 0;
+        } else {
+            pattern |= (1UL << rec_hold);  // WCET: 31
+            rec_hold = HOLD_NONE;
+        }
+    }
+    if (held || (can_edit && rec_step == step)) {
         should_play = 1;
-        pattern |= (1UL << step);
+        pattern |= (1UL << step);  // WCET: 31
         pattern_dirty = 1;
     } else if (can_edit && current_btn == BTN_B) {
         should_play = 0;
-        pattern &= ~(1UL << step);
+        pattern &= ~(1UL << step);  // WCET: 31
         pattern_dirty = 1;
     } else {
-        should_play = (pattern & (1UL << step)) ? 1 : 0;
+        should_play = (pattern & (1UL << step)) ? 1 : 0;  // WCET: 31
+    }
+
+    rec_step = REC_NONE;
+
+    uint8_t level = should_play ? lfo_accent(step) : 0;
+    cv_set(level);
+    if (should_play) {
+        TRACE_EVENT(TR_TRIG, step);
+        midi_note_on(level);
     }
+}
 
-    OCR1B = should_play ? CV_ACCENT : 0;
+// A press quantized to the nearest step: in the first half of a step it
+// belongs to the step that just fired, which is written and played at
+// once; in the second half it is queued for the next step, which plays it
+// even if the button was released before it fired
+static void record_press(void)
+{
+    uint16_t half = MS_PER_STEP() / 2;
+    uint8_t target = press_step;
+    if (press_tick < half)
+        target = (press_step - 1) & 0x1F;
+
+    uint8_t level = 0;
+    cli();
+    rec_hold = HOLD_PLACED;
+    if (target == current_step && !cv_ahead) {
+        rec_step = target;
+    } else if (!(pattern & (1UL << target))) {
+        // Already fired (more than one step back if the debounce ran past
+        // a step, or its CV already went out ahead of the grid): record,
+        // and play it if its step is still in its first half
+        pattern |= (1UL << target);
+        pattern_dirty = 1;
+        if (target == current_step ||
+            (target == ((current_step - 1) & 0x1F) && tick_count < half)) {
+            level = lfo_accent(target);
+            cv_set(level);
+            cv_gate_end = tick_count + CV_GATE_MS;
+            TRACE_EVENT(TR_TRIG, target);
+        }
+    }
+    sei();
+    if (level) midi_note_on(level);
 }
 
 // === Timer0 ISR: 1ms tick ===
+// MIDI builds let the bit clock interrupt this ISR (see midi.h)
+#ifdef MIDI
+ISR(TIMER0_COMPA_vect, ISR_NOBLOCK)
+#else
 ISR(TIMER0_COMPA_vect)
+#endif
 {
+    INSTR_ISR_ENTER();
     tick_count++;
+    ms_ticks++;
+    trace_tick();
 
-    if (tick_count >= MS_PER_STEP())
+    uint16_t step_ms = MS_PER_STEP();
+    if (tick_count >= step_ms)
     {
         tick_count = 0;
         step_triggered = 1;
+        TRACE_EVENT(TR_STEP, current_step);
+        midi_step_clock();
 
         update_led(current_step);
-        update_cv(current_step);
+        if (cv_ahead) {
+            // Gate started CV_LOOKAHEAD ticks ago
+            cv_gate_end = CV_GATE_MS - CV_LOOKAHEAD;
+        } else {
+            // On the grid (or a tempo change skipped the early slot)
+            cv_gate_end = CV_GATE_MS;
+            update_cv(current_step);
+        }
+        cv_ahead = 0;
 
         current_step = (current_step + 1) & 0x1F;
+    } else {
+        midi_tick(step_ms);
+#if CV_LOOKAHEAD > 0
+        if (tick_count == step_ms - CV_LOOKAHEAD) {
+            update_cv(current_step);  // Next step, ahead of the grid
+            cv_ahead = 1;
+        }
+#endif
     }
 
-    if (tick_count == CV_GATE_MS)
+    if (tick_count == cv_gate_end)
     {
-        OCR1B = 0;
+        cv_set(0);
+        midi_note_off();
     }
+    INSTR_ISR_EXIT();
 }
 
 // === Get Button State (with debounce) ===
@@ -248,6 +384,10 @@ uint8_t get_button(void)
     } else {
         last_raw = raw;
         match_count = 0;
+        cli();
+        press_step = current_step;
+        press_tick = tick_count;
+        sei();
     }
 
     return stable_btn;
@@ -256,178 +396,297 @@ uint8_t get_button(void)
 // === Setup ===
 void setup(void)
 {
-    // Timer1: PWM for CV on PB4 (OC1B) and LED on PB1 (OC1A)
-    TCCR1 = (1 << PWM1A) | (1 << COM1A1) | (1 << CS10); // PWM on OC1A
-    GTCCR = (1 << PWM1B) | (1 << COM1B1);               // PWM on OC1B
-    OCR1A = 0;                                          // LED starts off
-    OCR1B = 0;                                          // CV starts at 0
-    OCR1C = 255;                                        // TOP
-
-    // Timer0: 1ms interrupt
-    TCCR0A = (1 << WGM01);
-    TCCR0B = (1 << CS01) | (1 << CS00); // Prescaler 64
-    OCR0A = 124;                        // 8MHz / 64 / 125 = 1kHz
-    TIMSK |= (1 << OCIE0A);
-
-    // ADC
-    adc_init();
+    setup_hardware();
+    instr_init(TICK_PRESCALER);
+    trace_init();
+    midi_init();
 
-    // GPIO
-    DDRB |= (1 << CV_PIN) | (1 << LED_PIN);
+    // Step 0 fires on the first tick, not one step later
+    tick_count = MS_PER_STEP() - 1;
 
     sei();
 }
 
-// === Main ===
-int main(void)
+// === Load Settings ===
+// Reads only (a few microseconds), so the timers start at once. EEPROM that
+// needs writing (first boot, the pre-banks.h layout) is left to init_eeprom(),
+// which runs with the timers going.
+#define EE_INIT_NONE 0
+#define EE_INIT_BLANK 1   // No valid data: write the defaults
+#define EE_INIT_V1 2      // 8-bank layout: convert
+#define EE_INIT_HEADER 3  // 8-bank layout, banks converted: write the header
+#define EE_INIT_RESIZE 4  // Banks laid out for another BANK_COUNT: empty them
+static uint8_t ee_init = EE_INIT_NONE;
+
+static void load_settings(void)
 {
-    // Load settings from EEPROM (check magic byte for valid data)
-    if (eeprom_read_byte(EEPROM_MAGIC_ADDR) == EEPROM_MAGIC_VALUE) {
+    uint8_t magic = eeprom_read_byte(EEPROM_MAGIC_ADDR);
+    uint8_t *bpm_addr = EEPROM_BPM_ADDR;
+    if (magic == EEPROM_V1_MAGIC || magic == EEPROM_V1_SAVED_MAGIC) {
+        ee_init = magic == EEPROM_V1_MAGIC ? EE_INIT_V1 : EE_INIT_HEADER;
+        bpm_addr = EEPROM_V1_BPM_ADDR;
+    } else if (magic != EEPROM_MAGIC_VALUE) {
+        ee_init = EE_INIT_BLANK;
+    } else if (eeprom_read_byte(EEPROM_BANK_COUNT_ADDR) != BANK_COUNT) {
+        ee_init = EE_INIT_RESIZE;  // Settings kept, patterns not
+    }
+
+    if (ee_init != EE_INIT_BLANK) {
         current_bank = eeprom_read_byte(EEPROM_BANK_ADDR);
-        if (current_bank >= BANK_COUNT) current_bank = 0;
-        pattern = eeprom_read_dword(EEPROM_PATTERN_ADDR(current_bank));
-        current_bpm = eeprom_read_byte(EEPROM_BPM_ADDR);
-        if (current_bpm < BPM_MIN || current_bpm > BPM_MAX) current_bpm = BPM_DEFAULT;
-    } else {
-        // First boot: initialize EEPROM
-        eeprom_update_byte(EEPROM_MAGIC_ADDR, EEPROM_MAGIC_VALUE);
-        eeprom_update_byte(EEPROM_BANK_ADDR, 0);
-        for (uint8_t i = 0; i < BANK_COUNT; i++) {
-            eeprom_update_dword(EEPROM_PATTERN_ADDR(i), 0x00000000);
+        if (ee_init == EE_INIT_V1) {
+            if (current_bank >= EEPROM_V1_BANKS || current_bank >= BANK_COUNT) current_bank = 0;
+            pattern = eeprom_read_dword(EEPROM_V1_PATTERN_ADDR(current_bank));
+        } else {
+            if (current_bank >= BANK_COUNT) current_bank = 0;
+            if (ee_init != EE_INIT_RESIZE) pattern = bank_load(current_bank);
         }
-        eeprom_update_byte(EEPROM_BPM_ADDR, BPM_DEFAULT);
-        current_bank = 0;
-        pattern = 0x00000000;
-        current_bpm = BPM_DEFAULT;
+        // BPM and LFO bytes are in the same order in both layouts
+        current_bpm = eeprom_read_byte(bpm_addr);
+        if (current_bpm < BPM_MIN || current_bpm > BPM_MAX) current_bpm = BPM_DEFAULT;
+        lfo_wave = eeprom_read_byte(bpm_addr + 1);
+        if (lfo_wave >= LFO_WAVE_COUNT) lfo_wave = LFO_TRIANGLE;
+        lfo_rate = eeprom_read_byte(bpm_addr + 2);
+        if (lfo_rate >= LFO_RATE_COUNT) lfo_rate = LFO_RATE_DEFAULT;
+        lfo_depth = eeprom_read_byte(bpm_addr + 3);
+        if (lfo_depth > LFO_DEPTH_MAX) lfo_depth = LFO_DEPTH_DEFAULT;
     }
+    // else first boot: the defaults above
 
-    setup();
+    // Accents for the first pattern
+    lfo_render();
+}
 
-    uint8_t prev_step = 0;
-    uint8_t prev_btn = BTN_NONE;
-    uint16_t b_hold_time = 0;  // B button hold duration in ms
-    uint16_t m_hold_time = 0;  // M button hold duration in ms
-    uint16_t last_tick = 0;
+// === Write What load_settings() Left (timers running) ===
+// The main loop starts when this returns; the ISR keeps stepping through
+// the loaded pattern meanwhile. The bank store, BPM and LFO come from the
+// validated values in SRAM.
+static void init_eeprom(void)
+{
+    if (ee_init == EE_INIT_NONE) {
+        bank_init_cursor();
+        return;
+    }
+    TRACE_EVENT(TR_EE_START, TR_EE_INIT);
+    if (ee_init == EE_INIT_V1) {
+        // Writes nothing below BANK_IDS_BASE: cut short, it starts over
+        bank_clear_all();
+        for (uint8_t i = 0; i < EEPROM_V1_BANKS && i < BANK_COUNT; i++)
+            bank_save(i, eeprom_read_dword(EEPROM_V1_PATTERN_ADDR(i)));
+        eeprom_update_byte(EEPROM_MAGIC_ADDR, EEPROM_V1_SAVED_MAGIC);
+    } else if (ee_init != EE_INIT_HEADER) {
+        bank_clear_all();  // On a blank chip the ids already read as empty: no writes
+    }
+    // The BPM and LFO bytes overwrite the old layout's first patterns
+    eeprom_update_byte(EEPROM_BANK_ADDR, current_bank);
+    eeprom_update_byte(EEPROM_BPM_ADDR, current_bpm);
+    eeprom_update_byte(EEPROM_LFO_WAVE_ADDR, lfo_wave);
+    eeprom_update_byte(EEPROM_LFO_RATE_ADDR, lfo_rate);
+    eeprom_update_byte(EEPROM_LFO_DEPTH_ADDR, lfo_depth);
+    eeprom_update_byte(EEPROM_BANK_COUNT_ADDR, BANK_COUNT);     // A resize is done
+    eeprom_update_byte(EEPROM_MAGIC_ADDR, EEPROM_MAGIC_VALUE);  // Last: complete
+    TRACE_EVENT(TR_EE_END, TR_EE_INIT);
+    ee_init = EE_INIT_NONE;
+}
 
-    while (1)
-    {
-        // Update button state continuously (for ISR to use)
-        current_btn = get_button();
-
-        // Calculate elapsed time since last loop
-        uint16_t now = tick_count;
-        uint16_t elapsed = (now >= last_tick) ? (now - last_tick) : (now + MS_PER_STEP() - last_tick);
-        last_tick = now;
-
-        // B long press = clear pattern (only in Play mode, blocked during pending)
-        if (current_mode == MODE_PLAY && pending_bank == BANK_NO_PENDING && current_btn == BTN_B) {
-            b_hold_time += elapsed;
-            if (b_hold_time >= 1200) {
-                pattern = 0x00000000;
-                pattern_dirty = 1;
-                b_hold_time = 0;  // Reset to prevent repeated clear
-            }
-        } else {
-            b_hold_time = 0;
+// === Main Loop (one pass) ===
+static void loop(void)
+{
+    static uint8_t prev_step = 0;
+    static uint8_t prev_btn = BTN_NONE;
+    static uint16_t b_hold_time = 0;  // B button hold duration in ms
+    static uint16_t m_hold_time = 0;  // M button hold duration in ms
+    static uint8_t last_tick = 0;
+
+    // Update button state continuously (for ISR to use)
+    current_btn = get_button();
+    if (current_btn != BTN_A)
+        rec_hold = HOLD_NONE;
+
+    // Live recording: a new A press goes to the nearest step
+    if (current_mode == MODE_PLAY && pending_bank == BANK_NO_PENDING &&
+        current_btn == BTN_A && prev_btn != BTN_A) {
+        record_press();
+    }
+
+    // Calculate elapsed time since last loop (8-bit: single atomic read,
+    // wraps cleanly; tick_count can't be used as it restarts every step)
+    uint8_t now = ms_ticks;
+    uint8_t elapsed = now - last_tick;
+    last_tick = now;
+    if (elapsed >= TRACE_ADC_LATE_MS) TRACE_EVENT(TR_ADC_LATE, elapsed > 0x7F ? 0x7F : elapsed);
+
+    // B long press = clear pattern (only in Play mode, blocked during pending)
+    if (current_mode == MODE_PLAY && pending_bank == BANK_NO_PENDING && current_btn == BTN_B) {
+        b_hold_time += elapsed;
+        if (b_hold_time >= 1200) {
+            pattern = 0x00000000;
+            pattern_dirty = 1;
+            b_hold_time = 0;  // Reset to prevent repeated clear
         }
+    } else {
+        b_hold_time = 0;
+    }
 
-        // Mode button handling
-        if (current_btn == BTN_M) {
-            m_hold_time += elapsed;
-        } else {
-            if (prev_btn == BTN_M) {
-                // M button released
-                uint8_t prev_mode = current_mode;
-                if (m_hold_time < 500) {
-                    // Short press: toggle/cycle within layer
-                    if (current_mode == MODE_PLAY) {
-                        current_mode = MODE_BANK;
-                    } else if (current_mode == MODE_BANK) {
-                        current_mode = MODE_PLAY;
-                    } else {
-                        // Settings layer: cycle through settings modes
-                        current_mode = (current_mode >= SETTINGS_MODE_LAST)
-                            ? SETTINGS_MODE_FIRST
-                            : current_mode + 1;
-                    }
+    // Mode button handling
+    if (current_btn == BTN_M) {
+        m_hold_time += elapsed;
+    } else {
+        if (prev_btn == BTN_M) {
+            // M button released
+            uint8_t prev_mode = current_mode;
+            if (m_hold_time < 500) {
+                // Short press: toggle/cycle within layer
+                if (current_mode == MODE_PLAY) {
+                    current_mode = MODE_BANK;
+                } else if (current_mode == MODE_BANK) {
+                    current_mode = MODE_PLAY;
                 } else {
-                    // Long press: switch between main/settings layer
-                    if (current_mode <= MODE_BANK) {
-                        // Main → Settings (enter at Tempo)
-                        current_mode = MODE_TEMPO;
-                    } else {
-                        // Settings → Main (return to Play)
-                        current_mode = MODE_PLAY;
-                    }
+                    // Settings layer: cycle through settings modes
+                    current_mode = (current_mode >= SETTINGS_MODE_LAST)
+                        ? SETTINGS_MODE_FIRST
+                        : current_mode + 1;
                 }
-                // Save BPM when leaving Tempo mode
-                if (prev_mode == MODE_TEMPO && current_mode != MODE_TEMPO && bpm_dirty) {
-                    eeprom_update_byte(EEPROM_BPM_ADDR, current_bpm);
-                    bpm_dirty = 0;
+            } else {
+                // Long press: switch between main/settings layer
+                if (current_mode <= MODE_BANK) {
+                    // Main → Settings (enter at Tempo)
+                    current_mode = MODE_TEMPO;
+                } else {
+                    // Settings → Main (return to Play)
+                    current_mode = MODE_PLAY;
                 }
             }
-            m_hold_time = 0;  // Always reset when not pressing M
+            // Save BPM when leaving Tempo mode
+            if (prev_mode == MODE_TEMPO && current_mode != MODE_TEMPO && bpm_dirty) {
+                TRACE_EVENT(TR_EE_START, TR_EE_BPM);
+                eeprom_update_byte(EEPROM_BPM_ADDR, current_bpm);
+                TRACE_EVENT(TR_EE_END, TR_EE_BPM);
+                bpm_dirty = 0;
+            }
+            // Save LFO settings when leaving the mode they were changed in
+            if (current_mode != prev_mode && lfo_dirty) {
+                TRACE_EVENT(TR_EE_START, TR_EE_LFO);
+                eeprom_update_byte(EEPROM_LFO_WAVE_ADDR, lfo_wave);
+                eeprom_update_byte(EEPROM_LFO_RATE_ADDR, lfo_rate);
+                eeprom_update_byte(EEPROM_LFO_DEPTH_ADDR, lfo_depth);
+                TRACE_EVENT(TR_EE_END, TR_EE_LFO);
+                lfo_dirty = 0;
+            }
+            if (current_mode != prev_mode) TRACE_EVENT(TR_MODE, current_mode);
         }
+        m_hold_time = 0;  // Always reset when not pressing M
+    }
 
-        // Bank mode: A/B buttons change bank (on release)
-        if (current_mode == MODE_BANK) {
-            if (prev_btn == BTN_A && current_btn != BTN_A) {
-                // A released: bank down (with wrap)
-                uint8_t target = (pending_bank != BANK_NO_PENDING) ? pending_bank : current_bank;
-                schedule_bank_switch((target + BANK_COUNT - 1) % BANK_COUNT);
-            } else if (prev_btn == BTN_B && current_btn != BTN_B) {
-                // B released: bank up (with wrap)
-                uint8_t target = (pending_bank != BANK_NO_PENDING) ? pending_bank : current_bank;
-                schedule_bank_switch((target + 1) % BANK_COUNT);
-            }
+    // Bank mode: A/B buttons change bank (on release)
+    if (current_mode == MODE_BANK) {
+        if (prev_btn == BTN_A && current_btn != BTN_A) {
+            // A released: bank down (with wrap)
+            uint8_t target = (pending_bank != BANK_NO_PENDING) ? pending_bank : current_bank;
+            schedule_bank_switch((target + BANK_COUNT - 1) % BANK_COUNT);
+        } else if (prev_btn == BTN_B && current_btn != BTN_B) {
+            // B released: bank up (with wrap)
+            uint8_t target = (pending_bank != BANK_NO_PENDING) ? pending_bank : current_bank;
+            schedule_bank_switch((target + 1) % BANK_COUNT);
         }
+    }
 
-        // Tempo mode: A/B buttons change BPM (hold to repeat)
-        static uint16_t tempo_hold_time = 0;
-        #define TEMPO_REPEAT_MS 200
-        if (current_mode == MODE_TEMPO && (current_btn == BTN_A || current_btn == BTN_B)) {
-            uint8_t do_change = 0;
-            if (prev_btn != current_btn) {
-                // Button just pressed: immediate change
-                do_change = 1;
+    // Tempo mode: A/B buttons change BPM (hold to repeat)
+    static uint16_t tempo_hold_time = 0;
+    #define TEMPO_REPEAT_MS 200
+    if (current_mode == MODE_TEMPO && (current_btn == BTN_A || current_btn == BTN_B)) {
+        uint8_t do_change = 0;
+        if (prev_btn != current_btn) {
+            // Button just pressed: immediate change
+            do_change = 1;
+            tempo_hold_time = 0;
+        } else {
+            // Button held: repeat after interval
+            tempo_hold_time += elapsed;
+            if (tempo_hold_time >= TEMPO_REPEAT_MS) {
                 tempo_hold_time = 0;
-            } else {
-                // Button held: repeat after interval
-                tempo_hold_time += elapsed;
-                if (tempo_hold_time >= TEMPO_REPEAT_MS) {
-                    tempo_hold_time = 0;
-                    do_change = 1;
-                }
+                do_change = 1;
             }
-            if (do_change) {
-                if (current_btn == BTN_A && current_bpm > BPM_MIN) {
-                    current_bpm -= BPM_STEP;
-                    if (current_bpm < BPM_MIN) current_bpm = BPM_MIN;
-                    bpm_dirty = 1;
-                } else if (current_btn == BTN_B && current_bpm < BPM_MAX) {
-                    current_bpm += BPM_STEP;
-                    if (current_bpm > BPM_MAX) current_bpm = BPM_MAX;
-                    bpm_dirty = 1;
-                }
+        }
+        if (do_change) {
+            if (current_btn == BTN_A && current_bpm > BPM_MIN) {
+                current_bpm -= BPM_STEP;
+                if (current_bpm < BPM_MIN) current_bpm = BPM_MIN;
+                bpm_dirty = 1;
+            } else if (current_btn == BTN_B && current_bpm < BPM_MAX) {
+                current_bpm += BPM_STEP;
+                if (current_bpm > BPM_MAX) current_bpm = BPM_MAX;
+                bpm_dirty = 1;
             }
-        } else {
-            tempo_hold_time = 0;
         }
-        prev_btn = current_btn;
-
-        // Pattern start (step 31→0): apply pending bank switch and auto-save
-        uint8_t step = current_step;  // Read once (volatile)
-        if (step == 0 && prev_step == 31) {
-            // Apply pending bank switch first
-            apply_pending_bank();
-
-            // Auto-save if pattern changed
-            if (pattern_dirty) {
-                eeprom_update_byte(EEPROM_MAGIC_ADDR, EEPROM_MAGIC_VALUE);
-                eeprom_update_dword(EEPROM_PATTERN_ADDR(current_bank), pattern);
-                pattern_dirty = 0;
+    } else {
+        tempo_hold_time = 0;
+    }
+
+    // LFO modes: A/B step rate or depth, Etc mode: A cycles waveform
+    // (applied by lfo_render() at the next pattern start)
+    if (current_btn != prev_btn) {
+        if (current_mode == MODE_LFO_RATE) {
+            if (current_btn == BTN_A && lfo_rate > 0) {
+                lfo_rate--;
+                lfo_dirty = 1;
+            } else if (current_btn == BTN_B && lfo_rate < LFO_RATE_COUNT - 1) {
+                lfo_rate++;
+                lfo_dirty = 1;
             }
+        } else if (current_mode == MODE_LFO_DEPTH) {
+            if (current_btn == BTN_A && lfo_depth > 0) {
+                lfo_depth--;
+                lfo_dirty = 1;
+            } else if (current_btn == BTN_B && lfo_depth < LFO_DEPTH_MAX) {
+                lfo_depth++;
+                lfo_dirty = 1;
+            }
+        } else if (current_mode == MODE_ETC && current_btn == BTN_A) {
+            lfo_wave = (lfo_wave + 1) % LFO_WAVE_COUNT;
+            lfo_dirty = 1;
         }
-        prev_step = step;
+    }
+    prev_btn = current_btn;
+
+    // Pattern start (step 31→0): apply pending bank switch and auto-save
+    uint8_t step = current_step;  // Read once (volatile)
+    if (step != prev_step) {
+        instr_poll();
+    }
+    if (step == 0 && prev_step == 31) {
+        // Next pattern's accents, before any EEPROM stall
+        lfo_render();
+
+        // Apply pending bank switch
+        apply_pending_bank();
+
+        // Auto-save if pattern changed
+        // (cleared first: an edit during the save stays dirty; a full
+        // bank store leaves it set and tries again next bar)
+        if (pattern_dirty) {
+            TRACE_EVENT(TR_EE_START, TR_EE_PATTERN);
+            pattern_dirty = 0;
+            eeprom_update_byte(EEPROM_MAGIC_ADDR, EEPROM_MAGIC_VALUE);
+            if (!bank_save(current_bank, pattern))
+                pattern_dirty = 1;
+            TRACE_EVENT(TR_EE_END, TR_EE_PATTERN);
+        }
+    }
+    prev_step = step;
+
+    trace_drain();
+}
+
+// === Main ===
+#ifndef HOST_SIM
+int main(void)
+{
+    load_settings();
+    setup();
+    init_eeprom();
+
+    while (1) {
+        loop();
     }
 }
+#endif
@@ -0,0 +1,182 @@
+#ifndef MIDI_H
+#define MIDI_H
+
+#include <stdint.h>
+
+// --- MIDI Out (build with `make MIDI=1`) ---
+// 31250 baud 8N1 on PB0, open drain like the trace output (DIN pin 4 to
+// +5V and pin 5 to PB0, each through 220R). The USI shifts the bits in
+// two-wire mode; the bit clock is Timer1's overflow, which runs at PWM_HZ
+// = 31250 Hz on both clock profiles, so one overflow interrupt is one bit
+// cell. That interrupt is only enabled while bytes are queued.
+//
+// Messages go into a small ring from the 1ms tick ISR (clock, notes) or
+// the main loop (late live presses); nothing ever waits on the line.
+//   Clock   24 PPQN: 6 per step, the first when the step fires and the
+//           rest spread over the step's 1ms ticks (Bresenham, so each is
+//           within 1 ms of the exact grid)
+//   Start   before the first step (the sequencer plays from power-up and
+//           has no stopped state, so Stop is never sent)
+//   Note    note on for each triggered step, velocity from the accent;
+//           note off (running status, velocity 0) when the CV gate ends
+//
+// The tick ISR runs with interrupts enabled in MIDI builds so it cannot
+// hold a bit cell up; see DESIGN.md for the timing budget.
+
+#define MIDI_BAUD 31250UL
+#define MIDI_CLOCKS_PER_STEP 6   // 24 PPQN at 4 steps per beat
+#define MIDI_CLOCK 0xF8
+#define MIDI_START 0xFA
+#define MIDI_NOTE_ON 0x90
+
+#ifndef MIDI_CHANNEL
+#define MIDI_CHANNEL 10          // 1-16 (10: GM drums)
+#endif
+#ifndef MIDI_NOTE
+#define MIDI_NOTE 36             // GM bass drum
+#endif
+
+#ifdef MIDI
+
+#ifdef TRACE
+#error "MIDI and TRACE both use PB0 and the USI"
+#endif
+
+#define MIDI_RING_SIZE 16        // Bytes, power of 2
+
+_Static_assert(PWM_HZ == MIDI_BAUD, "Timer1 overflow must be one MIDI bit");
+
+uint8_t midi_ring[MIDI_RING_SIZE];
+volatile uint8_t midi_head = 0;      // Written by midi_put()
+volatile uint8_t midi_tail = 0;      // Written by the bit clock ISR
+volatile uint8_t midi_busy = 0;      // Bit clock running
+volatile uint8_t midi_dropped = 0;   // Bytes lost to a full ring (saturates)
+uint8_t midi_bit = 0;                // Bit cell of the current frame (0: start)
+uint8_t midi_d7;                     // USIDR for bit cell 8: d7 + stop + idle
+uint8_t midi_status = 0;             // Running status (0: none sent yet)
+uint8_t midi_note_held = 0;
+uint8_t midi_started = 0;
+uint8_t midi_clk_acc;                // Clock spacing accumulator (ms * 6)
+uint8_t midi_clk_count;              // Clocks sent in this step
+
+static inline void midi_init(void)
+{
+    midi_usi_init();
+}
+
+// Queue one byte (interrupts off)
+static inline void midi_put_locked(uint8_t b)
+{
+    uint8_t head = midi_head;
+    uint8_t next = (head + 1) & (MIDI_RING_SIZE - 1);
+    if (next == midi_tail) {
+        if (midi_dropped < 0xFF) midi_dropped++;
+        return;
+    }
+    midi_ring[head] = b;
+    midi_head = next;
+    if (!midi_busy) {
+        midi_busy = 1;
+        midi_bitclk_on();  // First bit cell starts at the next overflow
+    }
+}
+
+// Queue one byte; safe from the ISR and from the main loop
+static inline void midi_put(uint8_t b)
+{
+    uint8_t sreg = SREG;
+    cli();
+    midi_put_locked(b);
+    SREG = sreg;
+}
+
+// Bit clock: one bit cell per Timer1 overflow. Same frame split as
+// trace_send_byte(): load start + d0..d6, 7 strobes, load d7 + stop, 1 strobe.
+ISR(MIDI_BITCLK_vect)
+{
+    uint8_t bit = midi_bit;
+    if (bit == 0) {
+        uint8_t tail = midi_tail;
+        if (tail == midi_head) {
+            // Ring empty: line stays idle high until midi_put() restarts us
+            midi_bitclk_off();
+            midi_busy = 0;
+            return;
+        }
+        uint8_t rev = __builtin_avr_insert_bits(0x01234567, midi_ring[tail], 0);
+        midi_tail = (tail + 1) & (MIDI_RING_SIZE - 1);
+        midi_usi_load(rev >> 1);           // Start
+        midi_d7 = (rev << 7) | 0x7F;
+    } else if (bit == 8) {
+        midi_usi_load(midi_d7);            // d7
+    } else {
+        midi_usi_shift();                  // d0..d6, stop
+    }
+    midi_bit = (bit == 9) ? 0 : bit + 1;
+}
+
+// Note on/off as one unit, so a message from the other context cannot
+// land inside it (clock bytes may: MIDI allows that)
+static inline void midi_note(uint8_t velocity)
+{
+    const uint8_t status = MIDI_NOTE_ON | (MIDI_CHANNEL - 1);
+    uint8_t sreg = SREG;
+    cli();
+    if (midi_status != status) {
+        midi_status = status;
+        midi_put_locked(status);
+    }
+    midi_put_locked(MIDI_NOTE);
+    midi_put_locked(velocity);
+    midi_note_held = velocity != 0;
+    SREG = sreg;
+}
+
+// Tick ISR, when a step fires (before its note)
+static inline void midi_step_clock(void)
+{
+    if (!midi_started) {
+        midi_started = 1;
+        midi_put(MIDI_START);
+    }
+    midi_put(MIDI_CLOCK);
+    midi_clk_acc = 0;
+    midi_clk_count = 1;
+}
+
+// Tick ISR, every other ms: the remaining clocks of the step
+static inline void midi_tick(uint16_t step_ms)
+{
+    if (!midi_started || midi_clk_count >= MIDI_CLOCKS_PER_STEP) return;
+    midi_clk_acc += MIDI_CLOCKS_PER_STEP;
+    if (midi_clk_acc >= step_ms) {
+        midi_clk_acc -= step_ms;
+        midi_clk_count++;
+        midi_put(MIDI_CLOCK);
+    }
+}
+
+// CV level (accent, 1-255) -> velocity 1-127
+static inline void midi_note_on(uint8_t level)
+{
+    uint8_t velocity = level >> 1;
+    midi_note(velocity ? velocity : 1);
+}
+
+// Tick ISR, at the end of the CV gate
+static inline void midi_note_off(void)
+{
+    if (midi_note_held) midi_note(0);
+}
+
+#else
+
+static inline void midi_init(void) {}
+static inline void midi_step_clock(void) {}
+static inline void midi_tick(uint16_t step_ms) { (void)step_ms; }
+static inline void midi_note_on(uint8_t level) { (void)level; }
+static inline void midi_note_off(void) {}
+
+#endif // MIDI
+
+#endif // MIDI_H
@@ -1,6 +1,7 @@
 #include <avr/io.h>
 #include <avr/interrupt.h>
 #include <util/delay.h>
+#include "../common/clock.h"
 
 // --- Pin Configuration ---
 // PB1: LED output (GPIO)
@@ -95,21 +96,21 @@ uint8_t read_adc(uint8_t channel) {
 
 void setup(void) {
     // --- Timer1: PWM for CV on PB4 (OC1B) ---
-    TCCR1 = (1 << CS10);                      // No prescaler, ~31kHz PWM
+    TCCR1 = PWM_CS_BITS;                      // 31.25kHz PWM
     GTCCR = (1 << PWM1B) | (1 << COM1B1);     // PWM on OC1B, clear on match
     OCR1B = 0;                                // Start with 0V
     OCR1C = 255;                              // TOP = 255
 
     // --- Timer0: ~1ms interrupt for timing ---
-    // Requires 8MHz fuse (make fuse)
+    // Requires the CLOCK profile's fuse (make fuse)
     TCCR0A = (1 << WGM01);                    // CTC mode
-    TCCR0B = (1 << CS01) | (1 << CS00);       // Prescaler 64
-    OCR0A = 124;                              // 8MHz / 64 / 125 = 1kHz (1ms)
+    TCCR0B = TICK_CS_BITS;                    // Prescaler 64
+    OCR0A = TICK_OCR;                         // F_CPU / 64 / (OCR0A + 1) = 1kHz
     TIMSK |= (1 << OCIE0A);                   // Enable compare match interrupt
 
     // --- ADC for button reading ---
     ADMUX = (1 << ADLAR);                     // Left-adjust, VCC ref
-    ADCSRA = (1 << ADEN) | (1 << ADPS2) | (1 << ADPS1);  // Enable, prescaler 64
+    ADCSRA = (1 << ADEN) | ADC_PS_BITS;      // Enable, 125kHz ADC clock
 
     // --- Pin configuration ---
     DDRB |= (1 << CV_PIN);   // CV output (PWM)
@@ -0,0 +1,174 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+// --- Event Trace (build with `make TRACE=1`) ---
+// Timestamped events go into a small SRAM ring; the main loop drains it over
+// PB0 with the USI as a TX-only UART (8N1, LSB first). PB0 is driven open
+// drain in USI two-wire mode, so the I2C pull-up holds the line idle high.
+// Decode a capture with tools/trace_decode.py.
+//
+// Wire format, 4 bytes per event (only byte 0 has the top bit set):
+//   [0x80 | type] [arg & 0x7F] [ts & 0x7F] [(ts >> 7) & 0x7F]
+// ts counts 1/8 ms and wraps every ~2 s; steps are at most 250 ms apart, so
+// the decoder can always unwrap it.
+
+// Event types (keep in sync with tools/trace_decode.py)
+#define TR_STEP     0x01  // Step fired (arg: step)
+#define TR_TRIG     0x02  // CV trigger posted (arg: step)
+#define TR_EE_START 0x03  // EEPROM write start (arg: what, see TR_EE_*)
+#define TR_EE_END   0x04  // EEPROM write end (arg: what)
+#define TR_MODE     0x05  // Mode change (arg: new mode)
+#define TR_ADC_LATE 0x06  // Button sample interval overrun (arg: elapsed ms)
+#define TR_DROP     0x07  // Ring overflowed (arg: events lost)
+
+// TR_EE_START/TR_EE_END args
+#define TR_EE_PATTERN 0
+#define TR_EE_BANK    1
+#define TR_EE_BPM     2
+#define TR_EE_INIT    3
+#define TR_EE_LFO     4
+
+#define TRACE_ADC_LATE_MS 2 // Button sample gap that counts as overrun
+
+#ifdef TRACE
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#define TRACE_PIN PB0
+#define TRACE_BAUD 500000UL
+#define TRACE_BIT_CYCLES (F_CPU / TRACE_BAUD)
+#define TRACE_RING_SIZE 16  // Events, power of 2
+
+_Static_assert(F_CPU % TRACE_BAUD == 0, "TRACE_BAUD must divide F_CPU");
+_Static_assert(TRACE_BIT_CYCLES >= 8, "TRACE_BAUD too high for F_CPU");
+
+typedef struct {
+    uint8_t type;
+    uint8_t arg;
+    uint16_t ts;
+} trace_event_t;
+
+trace_event_t trace_ring[TRACE_RING_SIZE];
+volatile uint8_t trace_head = 0;   // Written by trace_event()
+volatile uint8_t trace_tail = 0;   // Written by trace_drain()
+volatile uint8_t trace_dropped = 0;
+volatile uint16_t trace_ms = 0;    // Free-running ms clock (tick_count resets every step)
+
+static inline void trace_init(void)
+{
+    USIDR = 0xFF;                       // Line idle high
+    USICR = (1 << USIWM1);              // Two-wire mode, software clock strobe
+    PORTB |= (1 << TRACE_PIN);
+    DDRB |= (1 << TRACE_PIN);
+}
+
+// Call from the 1ms Timer0 ISR
+static inline void trace_tick(void)
+{
+    trace_ms++;
+}
+
+// Timestamp in 1/8 ms: ms clock plus the top bits of TCNT0 (125 counts/ms)
+static inline uint16_t trace_now(void)
+{
+    uint16_t ms = trace_ms;
+    uint8_t sub = TCNT0;
+    if (TIFR & (1 << OCF0A)) {
+        // Compare match pending: TCNT0 restarted but trace_ms not yet bumped
+        ms++;
+        sub = TCNT0;
+    }
+    return (ms << 3) | (sub >> 4);
+}
+
+// Log one event; safe from the ISR and from the main loop. After an
+// overflow the loss is reported first, so the event needs two free slots.
+static inline void trace_event(uint8_t type, uint8_t arg)
+{
+    uint8_t sreg = SREG;
+    cli();
+    uint8_t head = trace_head;
+    uint8_t next = (head + 1) & (TRACE_RING_SIZE - 1);
+    uint8_t after = (next + 1) & (TRACE_RING_SIZE - 1);
+    if (next == trace_tail || (trace_dropped && after == trace_tail)) {
+        if (trace_dropped < 0x7F) trace_dropped++;
+    } else {
+        uint16_t ts = trace_now();
+        if (trace_dropped) {
+            trace_ring[head].type = TR_DROP;
+            trace_ring[head].arg = trace_dropped;
+            trace_ring[head].ts = ts;
+            trace_dropped = 0;
+            head = next;
+            next = after;
+        }
+        trace_ring[head].type = type;
+        trace_ring[head].arg = arg;
+        trace_ring[head].ts = ts;
+        trace_head = next;
+    }
+    SREG = sreg;
+}
+
+// Send one byte, LSB first. One USICLK strobe per bit; interrupts are held off
+// for the 10 bit times (20us at 500 kbaud) so the bit cells stay exact.
+static void trace_send_byte(uint8_t b)
+{
+    const uint8_t strobe = (1 << USIWM1) | (1 << USICLK);
+    uint8_t rev = __builtin_avr_insert_bits(0x01234567, b, 0);
+    uint8_t first = rev >> 1;             // Start bit + d0..d6
+    uint8_t second = (rev << 7) | 0x7F;   // d7 + stop bit, then idle
+
+    // Each bit cell is one OUT (1 cycle) plus padding
+    #define TRACE_BIT(reg, val) do { \
+        reg = (val); \
+        __builtin_avr_delay_cycles(TRACE_BIT_CYCLES - 1); \
+    } while (0)
+
+    uint8_t sreg = SREG;
+    cli();
+    TRACE_BIT(USIDR, first);   // Start
+    TRACE_BIT(USICR, strobe);  // d0
+    TRACE_BIT(USICR, strobe);  // d1
+    TRACE_BIT(USICR, strobe);  // d2
+    TRACE_BIT(USICR, strobe);  // d3
+    TRACE_BIT(USICR, strobe);  // d4
+    TRACE_BIT(USICR, strobe);  // d5
+    TRACE_BIT(USICR, strobe);  // d6
+    TRACE_BIT(USIDR, second);  // d7
+    TRACE_BIT(USICR, strobe);  // Stop
+    SREG = sreg;
+
+    #undef TRACE_BIT
+}
+
+// Main loop: send at most one event per call
+static inline void trace_drain(void)
+{
+    uint8_t tail = trace_tail;
+    if (tail == trace_head) return;
+
+    trace_event_t *e = &trace_ring[tail];
+    trace_send_byte(0x80 | e->type);
+    trace_send_byte(e->arg & 0x7F);
+    trace_send_byte(e->ts & 0x7F);
+    trace_send_byte((e->ts >> 7) & 0x7F);
+
+    trace_tail = (tail + 1) & (TRACE_RING_SIZE - 1);
+}
+
+#define TRACE_EVENT(type, arg) trace_event((type), (arg))
+
+#else
+
+#define TRACE_EVENT(type, arg) ((void)0)
+static inline void trace_init(void) {}
+static inline void trace_tick(void) {}
+static inline void trace_drain(void) {}
+
+#endif // TRACE
+
+#endif // TRACE_H
@@ -0,0 +1,195 @@
+// avrbench - cycle, stack and ISR benchmark of the AVR builds under simavr
+//
+// Loads a firmware ELF into simavr's ATtiny85 and plays a fixed scenario
+// against it, timing every Timer0 compare interrupt from its vector to the
+// matching reti (the 4-cycle interrupt response is not included; a nested
+// interrupt counts towards the one it interrupted). Prints one metric per
+// line, "name value", for tools/bench.py:
+//
+//   synth   idle, then each voice on its own (kick from a CV trigger, the
+//           rest by stepping the voice button, which triggers at full
+//           accent), then all six triggered within ~50 ms. DECAY and TONE
+//           pots at mid travel. Per window: isr_min/isr_avg/isr_max in
+//           cycles per sample (100 ms after each trigger).
+//   seq     idle playback (empty pattern), then button A held for a whole
+//           pattern so every step triggers: isr_* cycles per 1 ms tick
+//           (isr_max is a step tick).
+//
+// Both add stack (bytes below RAMEND ever used), cycles (total run) and
+// boot times from reset in us: boot.tick_us, the first Timer0 interrupt,
+// then synth.boot.audio_us, the first sample after Timer1 has moved onto
+// the PLL, and seq.boot.step_us, the first step (its LED flash). simavr
+// does not time EEPROM writes; seqsim's Boot line does.
+//
+// Usage: avrbench synth|seq ELF [-f F_CPU]
+
+#include "avrsim.h"
+
+// --- ISR Timing ---
+#define NEST_MAX 4
+static uint64_t nest_start[NEST_MAX];
+static uint8_t nest_vec[NEST_MAX];
+static int nest;
+static uint16_t sp_min = RAMEND;
+
+// --- Boot ---
+static int synth;
+static uint64_t boot_tick, boot_ready;  // Cycles from reset, 0 = not yet
+
+typedef struct {
+    uint64_t sum;
+    uint32_t count, min, max;
+} stats_t;
+
+static stats_t win;
+
+static void stats_reset(void)
+{
+    memset(&win, 0, sizeof(win));
+    win.min = UINT32_MAX;
+}
+
+static void tool_step(void)
+{
+    avrsim_step_t s = avrsim_step();
+
+    if (s.op == OP_RETI && nest > 0) {
+        nest--;
+        if (nest_vec[nest] == VEC_TIM0_COMPA) {
+            uint32_t c = (uint32_t)(avr->cycle - nest_start[nest]);
+            win.sum += c;
+            win.count++;
+            if (c < win.min) win.min = c;
+            if (c > win.max) win.max = c;
+        }
+    }
+    if (s.vector >= 0 && nest < NEST_MAX) {
+        nest_vec[nest] = s.vector;
+        nest_start[nest] = avr->cycle;
+        nest++;
+        if (s.vector == VEC_TIM0_COMPA) {
+            if (!boot_tick) boot_tick = avr->cycle;
+            if (synth && !boot_ready && (avr->data[DATA_PLLCSR] & (1 << PCKE)))
+                boot_ready = avr->cycle;
+        }
+    }
+    if (!synth && !boot_ready && avr->data[DATA_OCR1A])
+        boot_ready = avr->cycle;
+
+    uint16_t sp = avrsim_sp();
+    if (sp < sp_min) sp_min = sp;
+}
+
+static void print_boot(const char *name, uint64_t cycle)
+{
+    if (cycle)
+        printf("%s %.1f\n", name, cycle * 1e6 / f_cpu);
+}
+
+static void print_window(const char *name)
+{
+    if (!win.count) {
+        printf("%s.isr_count 0\n", name);
+        return;
+    }
+    printf("%s.isr_min %u\n", name, win.min);
+    printf("%s.isr_avg %.1f\n", name, (double)win.sum / win.count);
+    printf("%s.isr_max %u\n", name, win.max);
+}
+
+// --- Scenarios ---
+static void press_voice_button(void)
+{
+    avr_raise_irq(voice_btn_irq, 0);
+    avrsim_run_ms(4);  // update_voice_button() runs every 16 loop passes (~2 ms)
+    avr_raise_irq(voice_btn_irq, 1);
+    avrsim_run_ms(4);
+}
+
+static void bench_synth(void)
+{
+    static const char *voices[] = { "kick", "snare", "hihat", "clap", "tom", "cowbell" };
+    char name[32];
+
+    avrsim_set_adc(CH_SYNTH_CV, 0);
+    avrsim_set_adc(CH_SYNTH_DECAY, MV_POT_MID);
+    avrsim_set_adc(CH_SYNTH_TONE, MV_POT_MID);
+
+    avrsim_run_ms(50);  // PLL lock, first pot reads
+    stats_reset();
+    avrsim_run_ms(100);
+    print_window("synth.idle");
+
+    for (int v = 0; v < 6; v++) {
+        stats_reset();
+        if (v == 0) {
+            // Voice 0 is selected at reset: trigger it from the CV input
+            avrsim_set_adc(CH_SYNTH_CV, MV_HIGH);
+            avrsim_run_ms(5);
+            avrsim_set_adc(CH_SYNTH_CV, 0);
+            avrsim_run_ms(95);
+        } else {
+            press_voice_button();
+            avrsim_run_ms(92);
+        }
+        snprintf(name, sizeof(name), "synth.%s", voices[v]);
+        print_window(name);
+        avrsim_run_ms(2500);  // Longest decay is ~2 s
+    }
+
+    // Voice 5 is selected: six presses trigger 0..5 in turn
+    for (int v = 0; v < 6; v++)
+        press_voice_button();
+    stats_reset();
+    avrsim_run_ms(100);
+    print_window("synth.all");
+}
+
+static void bench_seq(void)
+{
+    avrsim_set_adc(CH_SEQ_BTN, MV_BTN_NONE);
+    avrsim_run_ms(500);  // First boot: EEPROM defaults
+    stats_reset();
+    avrsim_run_ms(4000);
+    print_window("seq.idle");
+
+    // Play mode: A held records every step it passes
+    avrsim_set_adc(CH_SEQ_BTN, MV_BTN_A);
+    avrsim_run_ms(4500);
+    avrsim_set_adc(CH_SEQ_BTN, MV_BTN_NONE);
+    stats_reset();
+    avrsim_run_ms(4000);
+    print_window("seq.play");
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3) goto usage;
+    const char *which = argv[1], *path = argv[2];
+    for (int i = 3; i < argc; i++) {
+        if (!strcmp(argv[i], "-f") && i + 1 < argc) f_cpu = strtoul(argv[++i], NULL, 0);
+        else goto usage;
+    }
+    synth = !strcmp(which, "synth");
+    if (!synth && strcmp(which, "seq")) goto usage;
+
+    if (avrsim_load("avrbench", path))
+        return 2;
+
+    if (synth) bench_synth();
+    else bench_seq();
+
+    const char *prefix = synth ? "synth" : "seq";
+    char name[32];
+    snprintf(name, sizeof(name), "%s.boot.tick_us", prefix);
+    print_boot(name, boot_tick);
+    snprintf(name, sizeof(name), "%s.boot.%s", prefix, synth ? "audio_us" : "step_us");
+    print_boot(name, boot_ready);
+    printf("%s.stack %u\n", prefix, RAMEND - sp_min);
+    printf("%s.cycles %llu\n", prefix, (unsigned long long)avr->cycle);
+    return 0;
+
+usage:
+    fprintf(stderr, "usage: %s synth|seq ELF [-f F_CPU]\n", argv[0]);
+    return 2;
+}
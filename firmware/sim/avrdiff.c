@@ -0,0 +1,378 @@
+// avrdiff - bit-exactness of the AVR build against the native reference
+//
+// Runs a firmware ELF in simavr's ATtiny85 and, in lock step, the same
+// firmware built natively (HOST_SIM, this binary): synthesizer/voices.h, or
+// sequencer/main.c when built with -DDIFF_SEQ. Both get the same inputs;
+// the native side gets them through the AVR's main loop:
+//
+//   entry   when the AVR vectors to a handler, every RAM variable the main
+//           loop changed since the last handler returned is copied into the
+//           native build, then the native handler runs once
+//   exit    at the outermost reti, OCR1A/OCR1B and every variable are
+//           compared, AVR against native
+//
+// Variables are the ELF's .data/.bss objects found by name in this binary
+// (link with -rdynamic), plus the registers MIXER=asm keeps voice state in
+// (voices.h: voice_active r3, lfsr r4:r5, k_phase r10:r11). So the native
+// state only follows the AVR's where the main loop wrote it; ISR state runs
+// free, and a difference stays visible from the sample it appears on. The
+// diff stops at the first divergent sample and prints every variable at
+// entry and at exit on both sides.
+//
+// Inputs: a script (-s), or the built-in session: synth CV triggers at
+// changing levels, the voice button and both pots swept; sequencer first
+// boot, recording, a bank switch and a tempo change.
+// Script: "MS INPUT VALUE" per line, '#' starts a comment. INPUT is cv,
+// decay or tone (mV) or voice (1 = button held) on the synth, btn (mV:
+// A 0, B 900, M 2200, none 5000) on the sequencer.
+//
+// Usage: avrdiff ELF [-f F_CPU] [-t S] [-s SCRIPT] [-o CSV]
+//   -t S      seconds to run (default 4, or the script's end + 0.5)
+//   -o CSV    OCR1A/OCR1B of both sides after every handler
+//
+// Exit status is 1 on a divergence, 2 if the run could not be set up.
+
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <unistd.h>
+#include <dlfcn.h>
+#include <link.h>
+#include <libelf.h>
+#include <gelf.h>
+
+#include "avrsim.h"
+
+// --- Native Build ---
+#ifdef DIFF_SEQ
+#include "../sequencer/main.c"
+
+uint8_t sim_led, sim_cv, SREG, sim_usidr = 0xFF, sim_bitclk, sim_emph;
+void setup_hardware(void) {}
+uint8_t read_adc(uint8_t channel) { (void)channel; return 255; }
+uint8_t eeprom_read_byte(const uint8_t *addr) { (void)addr; return 0xFF; }
+uint32_t eeprom_read_dword(const uint32_t *addr) { (void)addr; return 0xFFFFFFFF; }
+void eeprom_update_byte(uint8_t *addr, uint8_t value) { (void)addr; (void)value; }
+void eeprom_update_dword(uint32_t *addr, uint32_t value) { (void)addr; (void)value; }
+
+#define NATIVE_OCR1A sim_led
+#define NATIVE_OCR1B sim_cv
+#define CHIP "seq"
+#else
+#include "../synthesizer/voices.h"
+
+uint8_t SREG, DDRB, PORTB, PINB;
+uint8_t sim_pwm, sim_ocr1b;
+uint32_t sim_clips;
+
+#define NATIVE_OCR1A sim_pwm
+#define NATIVE_OCR1B sim_ocr1b
+#define CHIP "synth"
+#endif
+
+typedef struct {
+    uint8_t vector;
+    void (*handler)(void);
+} native_isr_t;
+
+static const native_isr_t native_isrs[] = {
+    { 10, TIMER0_COMPA_vect },
+#if defined(DIFF_SEQ) && defined(MIDI)
+    { 4, TIMER1_OVF_vect },
+#endif
+#if defined(DIFF_SEQ) && defined(FASTCV)
+    { 11, TIMER0_COMPB_vect },
+#endif
+};
+#define NATIVE_ISRS (sizeof(native_isrs) / sizeof(native_isrs[0]))
+
+#define DATA_OFFSET 0x800000   // ELF address of data space
+#define RAM_END (RAMEND + 1)
+
+// --- Shared Variables ---
+#define VAR_MAX 256
+#define VAR_BYTES 64
+typedef struct {
+    char name[32];
+    uint16_t addr;             // AVR data space (registers are 0-31)
+    uint16_t size;
+    uint8_t *native;
+    uint8_t shadow[VAR_BYTES]; // AVR bytes when the last handler returned
+    uint8_t entry[VAR_BYTES];  // Both sides at the current handler's entry
+} var_t;
+
+static var_t vars[VAR_MAX];
+static int n_vars, n_skipped;
+
+// State that is not the firmware's arithmetic
+static const char *excluded[] = { "instr", NULL };
+
+static void add_var(const char *name, uint16_t addr, uint16_t size)
+{
+    for (int i = 0; excluded[i]; i++)
+        if (!strcmp(name, excluded[i]))
+            return;
+    void *p = dlsym(RTLD_DEFAULT, name);
+    Dl_info info;
+    const ElfW(Sym) *sym = NULL;
+    if (!p || !dladdr1(p, &info, (void **)&sym, RTLD_DL_SYMENT) || !sym ||
+        sym->st_size != size || size > VAR_BYTES || n_vars == VAR_MAX) {
+        n_skipped++;
+        return;
+    }
+    var_t *v = &vars[n_vars++];
+    snprintf(v->name, sizeof(v->name), "%s", name);
+    v->addr = addr;
+    v->size = size;
+    v->native = p;
+    memcpy(v->shadow, p, size);  // First entry copies what differs from native
+}
+
+static int load_vars(const char *path)
+{
+    elf_version(EV_CURRENT);
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return -1;
+    Elf *e = elf_begin(fd, ELF_C_READ, NULL);
+    Elf_Scn *scn = NULL;
+    GElf_Shdr sh;
+    int has_voice_active = 0;
+    while ((scn = elf_nextscn(e, scn))) {
+        gelf_getshdr(scn, &sh);
+        if (sh.sh_type != SHT_SYMTAB)
+            continue;
+        Elf_Data *d = elf_getdata(scn, NULL);
+        for (size_t i = 0; i < sh.sh_size / sh.sh_entsize; i++) {
+            GElf_Sym s;
+            gelf_getsym(d, i, &s);
+            const char *name = elf_strptr(e, sh.sh_link, s.st_name);
+            if (GELF_ST_TYPE(s.st_info) != STT_OBJECT || !name || strchr(name, '.') ||
+                s.st_value < DATA_OFFSET || !s.st_size ||
+                s.st_value + s.st_size > DATA_OFFSET + RAM_END)
+                continue;
+            has_voice_active |= !strcmp(name, "voice_active");
+            add_var(name, s.st_value - DATA_OFFSET, s.st_size);
+        }
+    }
+    elf_end(e);
+    close(fd);
+#ifndef DIFF_SEQ
+    if (!has_voice_active) {
+        // MIXER=asm: register variables (voices.h)
+        add_var("voice_active", 3, 1);
+        add_var("lfsr", 4, 2);
+        add_var("k_phase", 10, 2);
+    }
+#endif
+    return n_vars ? 0 : -1;
+}
+
+// --- Lock Step ---
+#define NEST_MAX 4
+static uint8_t nest_vec[NEST_MAX];
+static int nest;
+static uint64_t n_handlers;
+static uint8_t entry_ocr[2];
+static FILE *csv;
+
+static void print_value(const uint8_t *p, uint16_t size)
+{
+    char buf[24];
+    if (size == 1) snprintf(buf, sizeof(buf), "0x%02X", p[0]);
+    else if (size == 2) snprintf(buf, sizeof(buf), "0x%04X", p[0] | p[1] << 8);
+    else if (size == 4)
+        snprintf(buf, sizeof(buf), "0x%08X", p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24);
+    else {
+        int n = 0;
+        for (int i = 0; i < size && n < (int)sizeof(buf) - 3; i++)
+            n += snprintf(buf + n, sizeof(buf) - n, "%02X", p[i]);
+    }
+    printf(" %12s", buf);
+}
+
+static void report(uint8_t vector, const uint8_t *avr_ocr, const uint8_t *nat_ocr)
+{
+    printf("avrdiff: divergence in handler %llu (vector %u), %.3f ms, cycle %llu\n",
+           (unsigned long long)n_handlers, vector, (double)avr->cycle * 1000 / f_cpu,
+           (unsigned long long)avr->cycle);
+    printf("%-20s %12s %12s %12s\n", "", "entry", "avr", "native");
+    const char *ocr_names[2] = { "OCR1A", "OCR1B" };
+    for (int i = 0; i < 2; i++) {
+        printf("%-20s", ocr_names[i]);
+        print_value(&entry_ocr[i], 1);
+        print_value(&avr_ocr[i], 1);
+        print_value(&nat_ocr[i], 1);
+        printf("%s\n", avr_ocr[i] != nat_ocr[i] ? "  <<" : "");
+    }
+    for (int i = 0; i < n_vars; i++) {
+        var_t *v = &vars[i];
+        printf("%-20s", v->name);
+        print_value(v->entry, v->size);
+        print_value(&avr->data[v->addr], v->size);
+        print_value(v->native, v->size);
+        printf("%s\n", memcmp(&avr->data[v->addr], v->native, v->size) ? "  <<" : "");
+    }
+}
+
+static void handler_entry(uint8_t vector)
+{
+    if (nest == 0) {
+        // Main loop writes since the last handler: into the native build
+        for (int i = 0; i < n_vars; i++) {
+            var_t *v = &vars[i];
+            uint8_t *a = &avr->data[v->addr];
+            if (memcmp(a, v->shadow, v->size))
+                memcpy(v->native, a, v->size);
+            memcpy(v->entry, a, v->size);
+        }
+        entry_ocr[0] = NATIVE_OCR1A = avr->data[DATA_OCR1A];
+        entry_ocr[1] = NATIVE_OCR1B = avr->data[DATA_OCR1B];
+    }
+    for (unsigned i = 0; i < NATIVE_ISRS; i++)
+        if (native_isrs[i].vector == vector)
+            native_isrs[i].handler();
+}
+
+static int handler_exit(uint8_t vector)
+{
+    n_handlers++;
+    uint8_t avr_ocr[2] = { avr->data[DATA_OCR1A], avr->data[DATA_OCR1B] };
+    uint8_t nat_ocr[2] = { NATIVE_OCR1A, NATIVE_OCR1B };
+    if (csv)
+        fprintf(csv, "%llu,%llu,%u,%u,%u,%u,%u\n", (unsigned long long)n_handlers,
+                (unsigned long long)avr->cycle, vector, avr_ocr[0], nat_ocr[0], avr_ocr[1],
+                nat_ocr[1]);
+    int diverged = memcmp(avr_ocr, nat_ocr, 2) != 0;
+    for (int i = 0; i < n_vars; i++) {
+        var_t *v = &vars[i];
+        if (memcmp(&avr->data[v->addr], v->native, v->size))
+            diverged = 1;
+        memcpy(v->shadow, &avr->data[v->addr], v->size);
+    }
+    if (diverged)
+        report(vector, avr_ocr, nat_ocr);
+    return diverged;
+}
+
+static void tool_step(void)
+{
+    avrsim_step_t s = avrsim_step();
+
+    if (s.op == OP_RETI && nest > 0) {
+        nest--;
+        if (nest == 0 && handler_exit(nest_vec[0]))
+            exit(1);
+    }
+    if (s.vector >= 0 && nest < NEST_MAX) {
+        handler_entry(s.vector);
+        nest_vec[nest++] = s.vector;
+    }
+}
+
+// --- Inputs ---
+static int set_input(const char *input, uint32_t value)
+{
+#ifdef DIFF_SEQ
+    if (!strcmp(input, "btn")) avrsim_set_adc(CH_SEQ_BTN, value);
+    else return -1;
+#else
+    if (!strcmp(input, "cv")) avrsim_set_adc(CH_SYNTH_CV, value);
+    else if (!strcmp(input, "decay")) avrsim_set_adc(CH_SYNTH_DECAY, value);
+    else if (!strcmp(input, "tone")) avrsim_set_adc(CH_SYNTH_TONE, value);
+    else if (!strcmp(input, "voice")) avr_raise_irq(voice_btn_irq, !value);
+    else return -1;
+#endif
+    return 0;
+}
+
+static int run_script(const char *path, uint32_t ms)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "avrdiff: cannot read %s\n", path);
+        return -1;
+    }
+    char line[128], input[16];
+    uint32_t now = 0, at, value;
+    int n = 0;
+    while (fgets(line, sizeof(line), f)) {
+        n++;
+        char *hash = strchr(line, '#');
+        if (hash) *hash = 0;
+        if (sscanf(line, "%u %15s %u", &at, input, &value) != 3) {
+            if (strspn(line, " \t\r\n") != strlen(line)) {
+                fprintf(stderr, "avrdiff: %s:%d: expected MS INPUT VALUE\n", path, n);
+                return -1;
+            }
+            continue;
+        }
+        if (at > now) {
+            avrsim_run_ms(at - now);
+            now = at;
+        }
+        if (set_input(input, value)) {
+            fprintf(stderr, "avrdiff: %s:%d: no input '%s'\n", path, n, input);
+            return -1;
+        }
+    }
+    fclose(f);
+    avrsim_run_ms(ms ? (ms > now ? ms - now : 0) : 500);
+    return 0;
+}
+
+static void session(uint32_t ms)
+{
+#ifdef DIFF_SEQ
+    avrsim_session_seq(ms);
+#else
+    avrsim_session_synth(ms);
+#endif
+}
+
+int main(int argc, char **argv)
+{
+    const char *script = NULL, *csv_path = NULL;
+    uint32_t ms = 0;
+
+    if (argc < 2) goto usage;
+    const char *path = argv[1];
+    for (int i = 2; i < argc; i++) {
+        if (i + 1 >= argc) goto usage;
+        if (!strcmp(argv[i], "-f")) f_cpu = strtoul(argv[++i], NULL, 0);
+        else if (!strcmp(argv[i], "-t")) ms = (uint32_t)(atof(argv[++i]) * 1000);
+        else if (!strcmp(argv[i], "-s")) script = argv[++i];
+        else if (!strcmp(argv[i], "-o")) csv_path = argv[++i];
+        else goto usage;
+    }
+
+    if (avrsim_load("avrdiff", path))
+        return 2;
+    if (load_vars(path)) {
+        fprintf(stderr, "avrdiff: no variables in %s shared with the native build\n", path);
+        return 2;
+    }
+
+    if (csv_path && !(csv = fopen(csv_path, "w"))) {
+        fprintf(stderr, "avrdiff: cannot write %s\n", csv_path);
+        return 2;
+    }
+    if (csv)
+        fprintf(csv, "handler,cycle,vector,avr_ocr1a,native_ocr1a,avr_ocr1b,native_ocr1b\n");
+
+    if (script) {
+        if (run_script(script, ms))
+            return 2;
+    } else {
+        session(ms ? ms : 4000);
+    }
+    if (csv)
+        fclose(csv);
+
+    printf("%s: %llu handlers bit-exact, %d variables compared (%d not in the native build)\n",
+           CHIP, (unsigned long long)n_handlers, n_vars, n_skipped);
+    return 0;
+
+usage:
+    fprintf(stderr, "usage: %s ELF [-f F_CPU] [-t S] [-s SCRIPT] [-o CSV]\n", argv[0]);
+    return 2;
+}
@@ -0,0 +1,405 @@
+// avrprof - sampling profiler of the AVR builds under simavr
+//
+// Runs a firmware ELF in simavr's ATtiny85 against a scripted session and
+// samples the program counter and call stack at random intervals (mean
+// -r Hz, uniform 0.5-1.5 of the mean so nothing locks to the mixer or tick
+// period). Each sample is weighted by the cycles since the previous one.
+//
+//   synth   CV triggers every 125 ms at changing levels, the voice button
+//           every 600 ms, DECAY and TONE swept over their travel
+//   seq     first boot (EEPROM defaults), steps recorded with A, a bank
+//           switch, a tempo change saved on leaving Tempo mode, playback
+//
+// The call stack is a shadow stack: a frame per rcall/icall and per
+// interrupt, dropped once SP rises above it (ret, reti, or anything else
+// that unwinds). Interrupt samples are rooted at their vector, so mixer or
+// tick time is not spread over whatever it interrupted. Functions come from
+// the ELF symbol table; inlined code counts to the function it was inlined
+// into (build with -fno-inline to split it out).
+//
+// Busy-waits are found statically: a backward branch over at most 8 words
+// that stores nothing, calls nothing, and either reads an I/O register
+// (ADSC, EEPE, PLOCK polls) or only counts down (_delay_ms). Samples there
+// are "busy" rather than "work", and get a [busy] leaf in the stacks.
+//
+// Prints the per-function cycle table (self work, self busy, inclusive)
+// and the busy-wait loops. -o writes folded stacks ("a;b;c cycles" per
+// line) for flamegraph.pl or speedscope.
+//
+// Usage: avrprof synth|seq ELF [-f F_CPU] [-t S] [-r HZ] [-o FILE]
+//   -t S      seconds to run (default 4 synth, 12 seq)
+//   -r HZ     mean sample rate (default 20000)
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <libelf.h>
+#include <gelf.h>
+
+#include "avrsim.h"
+
+#define FLASH_SIZE 8192
+#define IO_END 0x60            // I/O registers in data space
+
+static const char *vec_names[15] = {
+    "RESET", "INT0_vect", "PCINT0_vect", "TIMER1_COMPA_vect", "TIMER1_OVF_vect",
+    "TIMER0_OVF_vect", "EE_RDY_vect", "ANA_COMP_vect", "ADC_vect", "TIMER1_COMPB_vect",
+    "TIMER0_COMPA_vect", "TIMER0_COMPB_vect", "WDT_vect", "USI_START_vect", "USI_OVF_vect",
+};
+
+// --- Symbols ---
+#define SYM_MAX 512
+typedef struct {
+    uint32_t addr, size;
+    char name[48];
+} sym_t;
+
+static sym_t syms[SYM_MAX];
+static int n_syms;
+
+static int sym_cmp(const void *a, const void *b)
+{
+    const sym_t *x = a, *y = b;
+    return x->addr < y->addr ? -1 : x->addr > y->addr;
+}
+
+// Code symbols (functions and asm labels) from .symtab
+static int load_symbols(const char *path)
+{
+    elf_version(EV_CURRENT);
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return -1;
+    Elf *e = elf_begin(fd, ELF_C_READ, NULL);
+    Elf_Scn *scn = NULL;
+    size_t text = 0;
+    GElf_Shdr sh;
+    while ((scn = elf_nextscn(e, scn))) {
+        gelf_getshdr(scn, &sh);
+        size_t stridx;
+        elf_getshdrstrndx(e, &stridx);
+        if (!strcmp(elf_strptr(e, stridx, sh.sh_name), ".text"))
+            text = elf_ndxscn(scn);
+    }
+    while ((scn = elf_nextscn(e, scn))) {
+        gelf_getshdr(scn, &sh);
+        if (sh.sh_type != SHT_SYMTAB)
+            continue;
+        Elf_Data *d = elf_getdata(scn, NULL);
+        for (size_t i = 0; i < sh.sh_size / sh.sh_entsize && n_syms < SYM_MAX; i++) {
+            GElf_Sym s;
+            gelf_getsym(d, i, &s);
+            int type = GELF_ST_TYPE(s.st_info);
+            const char *name = elf_strptr(e, sh.sh_link, s.st_name);
+            if (s.st_shndx != text || !name || !*name || name[0] == '.')
+                continue;
+            if (type != STT_FUNC && type != STT_NOTYPE)
+                continue;
+            sym_t *y = &syms[n_syms++];
+            y->addr = s.st_value;
+            y->size = s.st_size;
+            unsigned v;
+            if (sscanf(name, "__vector_%u", &v) == 1 && v < 15)
+                name = vec_names[v];
+            snprintf(y->name, sizeof(y->name), "%s", name);
+        }
+    }
+    elf_end(e);
+    close(fd);
+    qsort(syms, n_syms, sizeof(sym_t), sym_cmp);
+    return n_syms ? 0 : -1;
+}
+
+// Function at a byte address: a sized function covering it, else the
+// nearest symbol before it (asm labels, libgcc's inner labels)
+static int sym_at(uint32_t addr)
+{
+    int best = -1;
+    for (int i = 0; i < n_syms && syms[i].addr <= addr; i++) {
+        if (syms[i].size && addr < syms[i].addr + syms[i].size)
+            best = i;
+        else if (best < 0 || !(syms[best].size && addr < syms[best].addr + syms[best].size))
+            best = i;
+    }
+    return best;
+}
+
+static const char *sym_name(int i)
+{
+    return i < 0 ? "?" : syms[i].name;
+}
+
+// --- Busy-Wait Loops ---
+static uint16_t busy_loop[FLASH_SIZE / 2];   // Word -> loop start word + 1, or 0
+
+static uint16_t op_at(uint32_t w)
+{
+    return avr->flash[2 * w] | (avr->flash[2 * w + 1] << 8);
+}
+
+static int two_words(uint16_t op)
+{
+    return (op & 0xFC0F) == 0x9000 || (op & 0xFE0C) == 0x940C;  // lds/sts, jmp/call
+}
+
+static void find_busy_loops(void)
+{
+    uint32_t words = FLASH_SIZE / 2;
+    for (uint32_t w = 0; w < words; w++) {
+        uint16_t op = op_at(w);
+        int k;
+        if ((op & 0xF800) == 0xF000)
+            k = (int8_t)((op >> 2) & 0xFE) >> 1;             // brbs/brbc, 7 bits
+        else if ((op & 0xF000) == 0xC000)
+            k = (int16_t)(op << 4) >> 4;                     // rjmp, 12 bits
+        else
+            continue;
+        if (k >= 0 || k < -9)
+            continue;
+        uint32_t start = w + 1 + k;
+        int io = 0, count_only = 1, writes = 0;
+        for (uint32_t i = start; i <= w; i++) {
+            uint16_t o = op_at(i);
+            if ((o & 0xFE00) == 0x9200 || (o & 0xD200) == 0x8200 ||     // st*, sts, push, std
+                (o & 0xF800) == 0xB800 || (o & 0xFD00) == 0x9800 ||     // out, cbi/sbi
+                (o & 0xF000) == 0xD000 || (o & 0xFE0E) == 0x940E || o == 0x9509)
+                writes = 1;
+            if ((o & 0xF800) == 0xB000 || (o & 0xFD00) == 0x9900 ||     // in, sbic/sbis
+                ((o & 0xFE0F) == 0x9000 && op_at(i + 1) < IO_END))      // lds of I/O
+                io = 1;
+            if (!((o & 0xF000) == 0x5000 || (o & 0xF000) == 0x4000 ||   // subi, sbci
+                  (o & 0xFF00) == 0x9700 || (o & 0xFE0F) == 0x940A ||   // sbiw, dec
+                  o == 0 || (o & 0xF800) == 0xF000 || (o & 0xF000) == 0xC000))
+                count_only = 0;
+            if (two_words(o))
+                i++;
+        }
+        if (writes || !(io || count_only))
+            continue;
+        for (uint32_t i = start; i <= w; i++)
+            busy_loop[i] = start + 1;
+    }
+}
+
+// --- Shadow Stack ---
+#define DEPTH_MAX 32
+typedef struct {
+    uint32_t site;     // Interrupted/calling pc (bytes)
+    uint16_t sp;       // SP right after the return address was pushed
+    uint8_t irq;
+} frame_t;
+
+static frame_t frames[DEPTH_MAX];
+static int depth;
+
+static void push_frame(uint32_t site, uint16_t sp, uint8_t irq)
+{
+    if (depth < DEPTH_MAX)
+        frames[depth++] = (frame_t){ site, sp, irq };
+}
+
+// --- Samples ---
+typedef struct {
+    uint64_t work, busy, incl;
+} cost_t;
+
+static cost_t fn_cost[SYM_MAX + 1];          // [SYM_MAX]: unknown
+static uint64_t loop_cost[FLASH_SIZE / 2];
+static uint64_t total, total_busy, total_irq;
+
+#define STACKS_MAX 4096
+static struct {
+    char *key;
+    uint64_t cycles;
+} stacks[STACKS_MAX];
+
+static uint32_t hash(const char *s)
+{
+    uint32_t h = 5381;
+    while (*s) h = h * 33 + (uint8_t)*s++;
+    return h;
+}
+
+static void add_stack(const char *key, uint64_t cycles)
+{
+    uint32_t i = hash(key) & (STACKS_MAX - 1);
+    for (uint32_t n = 0; n < STACKS_MAX; n++, i = (i + 1) & (STACKS_MAX - 1)) {
+        if (!stacks[i].key) {
+            stacks[i].key = strdup(key);
+            stacks[i].cycles = cycles;
+            return;
+        }
+        if (!strcmp(stacks[i].key, key)) {
+            stacks[i].cycles += cycles;
+            return;
+        }
+    }
+}
+
+static void sample(uint64_t cycles)
+{
+    // Pcs from the root: an interrupt starts a new root at its handler
+    uint32_t pcs[DEPTH_MAX + 1];
+    int n = 0, root = 0;
+    for (int i = 0; i < depth; i++)
+        if (frames[i].irq)
+            root = i + 1;
+    if (root == 0 && depth > 0)
+        pcs[n++] = frames[0].site;
+    for (int i = root ? root : 1; i < depth; i++)
+        pcs[n++] = frames[i].site;
+    pcs[n++] = avr->pc;
+
+    char key[1024];
+    size_t len = 0;
+    int seen[DEPTH_MAX + 1], n_seen = 0;
+    for (int i = 0; i < n; i++) {
+        int s = sym_at(pcs[i]);
+        len += snprintf(key + len, sizeof(key) - len, "%s%s", i ? ";" : "", sym_name(s));
+        if (len >= sizeof(key)) len = sizeof(key) - 1;
+        int dup = 0;
+        for (int j = 0; j < n_seen; j++)
+            dup |= seen[j] == s;
+        if (!dup) {
+            seen[n_seen++] = s;
+            fn_cost[s < 0 ? SYM_MAX : s].incl += cycles;
+        }
+    }
+    int self = sym_at(avr->pc);
+    cost_t *c = &fn_cost[self < 0 ? SYM_MAX : self];
+    uint16_t loop = busy_loop[avr->pc / 2];
+    if (loop) {
+        c->busy += cycles;
+        loop_cost[loop - 1] += cycles;
+        total_busy += cycles;
+        snprintf(key + len, sizeof(key) - len, ";[busy]");
+    } else {
+        c->work += cycles;
+    }
+    if (root)
+        total_irq += cycles;
+    total += cycles;
+    add_stack(key, cycles);
+}
+
+// --- Run ---
+static uint64_t next_sample, last_sample;
+static uint32_t mean_interval;
+static uint32_t rng = 1;
+
+static void tool_step(void)
+{
+    uint16_t sp0 = avrsim_sp();
+    avrsim_step_t s = avrsim_step();
+
+    uint16_t sp = avrsim_sp();
+    while (depth && frames[depth - 1].sp < sp)
+        depth--;
+    // rcall .+0 reserves stack space, it is not a call
+    int call = ((s.op & 0xF000) == 0xD000 && (s.op & 0x0FFF) != 0) ||
+               (s.op & 0xFE0E) == 0x940E || s.op == 0x9509;
+    if (call && sp < sp0)
+        push_frame(s.pc, sp0 - 2, 0);
+    if (s.vector >= 0)
+        push_frame(s.pc, sp, 1);
+
+    if (avr->cycle >= next_sample) {
+        sample(avr->cycle - last_sample);
+        last_sample = avr->cycle;
+        rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5;
+        next_sample = avr->cycle + mean_interval / 2 + rng % (mean_interval + 1);
+    }
+}
+
+static int cost_cmp(const void *a, const void *b)
+{
+    const cost_t *x = &fn_cost[*(const int *)a], *y = &fn_cost[*(const int *)b];
+    uint64_t sx = x->work + x->busy, sy = y->work + y->busy;
+    return sx < sy ? 1 : sx > sy ? -1 : 0;
+}
+
+static double pct(uint64_t c)
+{
+    return total ? 100.0 * c / total : 0;
+}
+
+int main(int argc, char **argv)
+{
+    const char *out_path = NULL;
+    uint32_t ms = 0, rate = 20000;
+
+    if (argc < 3) goto usage;
+    const char *which = argv[1], *path = argv[2];
+    for (int i = 3; i < argc; i++) {
+        if (i + 1 >= argc) goto usage;
+        if (!strcmp(argv[i], "-f")) f_cpu = strtoul(argv[++i], NULL, 0);
+        else if (!strcmp(argv[i], "-t")) ms = (uint32_t)(atof(argv[++i]) * 1000);
+        else if (!strcmp(argv[i], "-r")) rate = strtoul(argv[++i], NULL, 0);
+        else if (!strcmp(argv[i], "-o")) out_path = argv[++i];
+        else goto usage;
+    }
+    int synth = !strcmp(which, "synth");
+    if (!synth && strcmp(which, "seq")) goto usage;
+    if (rate < 100 || rate > f_cpu / 20) goto usage;
+    if (!ms) ms = synth ? 4000 : 12000;
+
+    if (avrsim_load("avrprof", path))
+        return 2;
+    if (load_symbols(path)) {
+        fprintf(stderr, "avrprof: no code symbols in %s\n", path);
+        return 2;
+    }
+
+    find_busy_loops();
+    mean_interval = f_cpu / rate;
+    next_sample = mean_interval;
+
+    if (synth) avrsim_session_synth(ms);
+    else avrsim_session_seq(ms);
+
+    // Per-function table, by self cycles
+    int order[SYM_MAX + 1], n = 0;
+    for (int i = 0; i <= SYM_MAX; i++)
+        if (fn_cost[i].incl)
+            order[n++] = i;
+    qsort(order, n, sizeof(int), cost_cmp);
+
+    printf("%s, %.1f s, %llu cycles: interrupts %.1f%%, busy-wait %.1f%%\n", which,
+           (double)avr->cycle / f_cpu, (unsigned long long)total, pct(total_irq),
+           pct(total_busy));
+    printf("%-28s %10s %6s %10s %6s %6s\n", "function", "work", "%", "busy", "%", "incl%");
+    for (int k = 0; k < n; k++) {
+        const cost_t *c = &fn_cost[order[k]];
+        printf("%-28s %10llu %6.2f %10llu %6.2f %6.2f\n",
+               order[k] == SYM_MAX ? "?" : syms[order[k]].name, (unsigned long long)c->work,
+               pct(c->work), (unsigned long long)c->busy, pct(c->busy), pct(c->incl));
+    }
+
+    printf("\n%-36s %10s %6s\n", "busy-wait loop", "cycles", "%");
+    for (uint32_t w = 0; w < FLASH_SIZE / 2; w++) {
+        if (!loop_cost[w])
+            continue;
+        int s = sym_at(2 * w);
+        char where[64];
+        snprintf(where, sizeof(where), "%s+0x%x (0x%04x)", sym_name(s),
+                 s < 0 ? 0 : 2 * w - syms[s].addr, 2 * w);
+        printf("%-36s %10llu %6.2f\n", where, (unsigned long long)loop_cost[w],
+               pct(loop_cost[w]));
+    }
+
+    if (out_path) {
+        FILE *f = fopen(out_path, "w");
+        if (!f) {
+            fprintf(stderr, "avrprof: cannot write %s\n", out_path);
+            return 2;
+        }
+        for (int i = 0; i < STACKS_MAX; i++)
+            if (stacks[i].key)
+                fprintf(f, "%s %llu\n", stacks[i].key, (unsigned long long)stacks[i].cycles);
+        fclose(f);
+    }
+    return 0;
+
+usage:
+    fprintf(stderr, "usage: %s synth|seq ELF [-f F_CPU] [-t S] [-r HZ] [-o FILE]\n", argv[0]);
+    return 2;
+}
@@ -0,0 +1,167 @@
+#ifndef AVRSIM_H
+#define AVRSIM_H
+
+// --- simavr ATtiny85 Harness (avrbench, avrprof, avrdiff) ---
+// Loads a firmware ELF into simavr's ATtiny85, single-steps it and drives
+// the inputs both boards read: the ADC channels (in mV) and the synth's
+// voice button. The tool defines tool_step(), which calls avrsim_step() and
+// does its own bookkeeping; avrsim_run_ms() and the sessions step through
+// it. avrsim_step() reports the vector the core just entered, so the tools
+// agree on what counts as an interrupt.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <simavr/sim_avr.h>
+#include <simavr/sim_elf.h>
+#include <simavr/sim_io.h>
+#include <simavr/avr_adc.h>
+#include <simavr/avr_ioport.h>
+
+// --- ATtiny85 ---
+#define VEC_TABLE_END 0x1E     // 15 vectors, one rjmp (2 bytes) each
+#define VEC_TIM0_COMPA 10
+#define RAMEND 0x25F
+#define OP_RETI 0x9518
+#define DATA_PLLCSR 0x47       // Data-space addresses of the I/O registers
+#define PCKE 2
+#define DATA_OCR1A 0x4E
+#define DATA_OCR1B 0x4B
+
+// --- Inputs ---
+#define MV_HIGH 5000
+#define MV_POT_MID 2500
+#define MV_BTN_A 0             // Sequencer divider (sequencer/main.c BTN_x_MAX)
+#define MV_BTN_B 900
+#define MV_BTN_M 2200
+#define MV_BTN_NONE 5000
+#define CH_SYNTH_CV 2          // synthesizer/hardware.h
+#define CH_SYNTH_DECAY 1
+#define CH_SYNTH_TONE 3
+#define CH_SEQ_BTN 3           // sequencer/hardware.h
+#define PIN_VOICE_BTN 0        // PB0, active low
+
+static avr_t *avr;
+static avr_irq_t *adc_irq;
+static avr_irq_t *voice_btn_irq;
+static unsigned long f_cpu = 8000000;
+static const char *avrsim_tool = "avrsim";
+
+static void tool_step(void);
+
+// Loads path and resets the core, inputs idle (button up, pots mid)
+static inline int avrsim_load(const char *tool, const char *path)
+{
+    avrsim_tool = tool;
+    elf_firmware_t fw;
+    memset(&fw, 0, sizeof(fw));
+    if (elf_read_firmware(path, &fw)) {
+        fprintf(stderr, "%s: cannot load %s\n", tool, path);
+        return -1;
+    }
+    avr = avr_make_mcu_by_name("attiny85");
+    if (!avr) {
+        fprintf(stderr, "%s: simavr has no attiny85 core\n", tool);
+        return -1;
+    }
+    avr_init(avr);
+    avr_load_firmware(avr, &fw);
+    avr->frequency = f_cpu;
+    avr->vcc = avr->avcc = avr->aref = 5000;
+    adc_irq = avr_io_getirq(avr, AVR_IOCTL_ADC_GETIRQ, 0);
+    voice_btn_irq = avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('B'), PIN_VOICE_BTN);
+    avr_raise_irq(voice_btn_irq, 1);
+    avr_raise_irq(adc_irq + ADC_IRQ_ADC0 + CH_SYNTH_DECAY, MV_POT_MID);
+    avr_raise_irq(adc_irq + ADC_IRQ_ADC0 + CH_SYNTH_TONE, MV_POT_MID);
+    return 0;
+}
+
+// --- Stepping ---
+typedef struct {
+    avr_flashaddr_t pc;        // Where the step ran (bytes)
+    uint16_t op;               // The instruction there (OP_RETI: a return)
+    int vector;                // Vector the core just entered, or -1
+} avrsim_step_t;
+
+static inline uint16_t avrsim_sp(void)
+{
+    return avr->data[R_SPL] | (avr->data[R_SPH] << 8);
+}
+
+static inline avrsim_step_t avrsim_step(void)
+{
+    avrsim_step_t s = { avr->pc, 0, -1 };
+    s.op = avr->flash[s.pc] | (avr->flash[s.pc + 1] << 8);
+
+    int state = avr_run(avr);
+    if (state == cpu_Done || state == cpu_Crashed) {
+        fprintf(stderr, "%s: core stopped at pc 0x%04X\n", avrsim_tool, (unsigned)avr->pc);
+        exit(2);
+    }
+    // Vectored: the core jumped into the table from outside it
+    if (avr->pc != 0 && avr->pc < VEC_TABLE_END && s.pc >= VEC_TABLE_END)
+        s.vector = avr->pc / 2;
+    return s;
+}
+
+static inline void avrsim_run_ms(uint32_t ms)
+{
+    uint64_t end = avr->cycle + (uint64_t)f_cpu / 1000 * ms;
+    while (avr->cycle < end)
+        tool_step();
+}
+
+static inline void avrsim_set_adc(int ch, uint32_t mv)
+{
+    avr_raise_irq(adc_irq + ADC_IRQ_ADC0 + ch, mv);
+}
+
+// --- Sessions (avrprof, avrdiff) ---
+// Synth: CV triggers every 125 ms at changing levels, the voice button
+// every 600 ms, DECAY and TONE swept over their travel
+static inline void avrsim_session_synth(uint32_t ms)
+{
+    avrsim_set_adc(CH_SYNTH_CV, 0);
+    for (uint32_t t = 0; t < ms; t += 5) {
+        uint32_t phase = t % 125;
+        if (phase == 0)
+            avrsim_set_adc(CH_SYNTH_CV, 1000 + (t / 125 % 4) * 1300);
+        else if (phase == 10)
+            avrsim_set_adc(CH_SYNTH_CV, 0);
+        avr_raise_irq(voice_btn_irq, t % 600 >= 300 && t % 600 < 310 ? 0 : 1);
+        avrsim_set_adc(CH_SYNTH_DECAY, t * 5 % 5000);
+        avrsim_set_adc(CH_SYNTH_TONE, 5000 - t * 3 % 5000);
+        avrsim_run_ms(5);
+    }
+}
+
+static inline void avrsim_press(uint32_t mv, uint32_t hold_ms, uint32_t gap_ms)
+{
+    avrsim_set_adc(CH_SEQ_BTN, mv);
+    avrsim_run_ms(hold_ms);
+    avrsim_set_adc(CH_SEQ_BTN, MV_BTN_NONE);
+    avrsim_run_ms(gap_ms);
+}
+
+// Sequencer: first boot, steps recorded with A, a bank switch, a tempo
+// change saved on leaving Tempo mode, playback
+static inline void avrsim_session_seq(uint32_t ms)
+{
+    uint64_t end = avr->cycle + (uint64_t)f_cpu / 1000 * ms;
+    avrsim_set_adc(CH_SEQ_BTN, MV_BTN_NONE);
+    avrsim_run_ms(500);                      // First boot: EEPROM defaults
+    avrsim_press(MV_BTN_A, 400, 600);        // Record a few steps (saved at the bar)
+    avrsim_press(MV_BTN_M, 100, 300);        // Bank mode
+    avrsim_press(MV_BTN_B, 50, 300);         // Next bank, switched at the bar
+    avrsim_press(MV_BTN_M, 100, 300);        // Play
+    avrsim_press(MV_BTN_M, 700, 300);        // Tempo
+    for (int i = 0; i < 3; i++)
+        avrsim_press(MV_BTN_B, 50, 150);
+    avrsim_press(MV_BTN_M, 700, 300);        // Play: BPM saved
+    while (avr->cycle < end)
+        avrsim_run_ms(1);
+}
+
+#endif // AVRSIM_H
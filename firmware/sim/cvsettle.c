@@ -0,0 +1,152 @@
+// cvsettle - CV filter settling and ripple, 31.25kHz vs FASTCV
+//
+// Builds sequencer/fastcv.h natively (FASTCV, its table made for
+// CV_RC_US) and drives a one-pole RC filter of each time constant from 0V
+// to each CV level, three ways:
+//   31k    OCR1B = level, 31.25kHz PWM (the default build)
+//   250k   OCR1B = level, 250kHz PWM from the PLL
+//   emph   250kHz and cv_set(level): full scale for the table's time (in
+//          Timer0 counts, started at a random point of the first count),
+//          then the level
+// OCR1B takes effect at the next PWM TOP; each case is run at 8 phases of
+// the PWM period against the write, and the worst is kept. Settling is the
+// time from the write until the PWM-period average of the filter output
+// stays within 1 count (5V / 256) of the level; the worst is over levels
+// 16-240. Full scale (255) is listed on its own: there is nothing above it
+// to overdrive with, so it settles as plain 250kHz does. Ripple is peak to
+// peak at 50% duty.
+//
+// Usage: cvsettle [-t US] [-v]
+//   -t US     one RC time constant (default: 47 to 2200 us)
+//   -v        settling per level, not just the worst
+//
+// Build with `make cvsettle CV_RC_US=...` for another table. Exit status is
+// 1 if pre-emphasis settles slower than plain 250kHz PWM at CV_RC_US.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define FASTCV
+#include "host.h"
+#include "../sequencer/fastcv.h"
+
+uint8_t sim_cv;
+uint8_t sim_emph;
+
+#define VCC 5.0
+#define LSB (VCC / 256)
+#define PHASES 8
+
+enum { M_31K, M_250K, M_EMPH, M_COUNT };
+static const double mode_pwm_us[M_COUNT] = { 32, 4, 4 };
+
+static double tau_us;
+
+// One PWM period at duty d from v; returns the end voltage, *avg the mean
+static double pwm_period(double v, uint8_t d, double pwm_us, double *avg)
+{
+    double high = pwm_us * d / 256, low = pwm_us - high;
+    double a = tau_us * (1 - exp(-high / tau_us));
+    double v1 = VCC + (v - VCC) * exp(-high / tau_us);
+    double sum = VCC * high + (v - VCC) * a;          // Integral over the high part
+    sum += v1 * tau_us * (1 - exp(-low / tau_us));    // and the low part
+    *avg = sum / pwm_us;
+    return v1 * exp(-low / tau_us);
+}
+
+// Settling time (us) from 0V to level; phase in [0, 1) of a PWM period
+static double settle(int mode, uint8_t level, double phase)
+{
+    double pwm_us = mode_pwm_us[mode];
+    double write = pwm_us * phase;       // OCR1B write, before the next TOP
+    double emph_end = 0;
+
+    if (mode == M_EMPH) {
+        cv_level = 0;
+        cv_set(level);
+        if (sim_cv == CV_FULL && sim_emph) {
+            // Compare B fires n count boundaries after the write; the write
+            // lands somewhere in its count
+            double into_count = CV_EMPH_US * phase;
+            emph_end = write + sim_emph * CV_EMPH_US - into_count;
+        }
+        sim_emph = 0;
+    }
+
+    double target = level * VCC / 256;
+    double v = 0, last_out = 0, avg;
+    double t_end = emph_end + 30 * tau_us + 100;
+    for (double t = 0; t < t_end; t += pwm_us) {
+        // Duty for the period starting at t: OCR1B as of this TOP
+        uint8_t d = 0;
+        if (t >= write) d = (mode == M_EMPH && t < emph_end) ? CV_FULL : level;
+        v = pwm_period(v, d, pwm_us, &avg);
+        if (fabs(avg - target) > LSB)
+            last_out = t + pwm_us;
+    }
+    return last_out - write;
+}
+
+static double ripple(double pwm_us)
+{
+    double v = VCC / 2, avg;
+    for (int i = 0; i < 100000 && i * pwm_us < 50 * tau_us; i++)
+        v = pwm_period(v, 128, pwm_us, &avg);
+    double high = pwm_us / 2;
+    double v1 = VCC + (v - VCC) * exp(-high / tau_us);
+    return (v1 - v) * 1000;
+}
+
+int main(int argc, char **argv)
+{
+    static const double taus[] = { 47, 100, 220, 470, 1000, 2200 };
+    double tau_arg = 0;
+    int verbose = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-v")) verbose = 1;
+        else if (!strcmp(argv[i], "-t") && i + 1 < argc) tau_arg = atof(argv[++i]);
+        else goto usage;
+    }
+    if (tau_arg < 0) goto usage;
+
+    printf("CV filter settling to 1 count (5V/256) from 0V, table for CV_RC_US %d\n", CV_RC_US);
+    printf("%7s %19s %29s %9s\n", "", "ripple p-p (mV)", "worst settle, 16-240 (us)",
+           "255 (us)");
+    printf("%7s %9s %9s %9s %9s %9s %9s\n", "tau_us", "31k", "250k", "31k", "250k", "emph",
+           "250k");
+
+    int fail = 0;
+    int n_taus = tau_arg ? 1 : (int)(sizeof(taus) / sizeof(taus[0]));
+    for (int ti = 0; ti < n_taus; ti++) {
+        tau_us = tau_arg ? tau_arg : taus[ti];
+        double worst[M_COUNT] = { 0 }, full = 0;
+        for (int l = 16; l <= 256; l += 16) {
+            uint8_t level = l > 255 ? 255 : l;
+            double s[M_COUNT] = { 0 };
+            for (int m = 0; m < M_COUNT; m++) {
+                for (int p = 0; p < PHASES; p++) {
+                    double t = settle(m, level, (double)p / PHASES);
+                    if (t > s[m]) s[m] = t;
+                }
+                if (level < 255 && s[m] > worst[m]) worst[m] = s[m];
+            }
+            if (level == 255) full = s[M_250K];
+            if (verbose)
+                printf("%7s cv %3u %26.0f %9.0f %9.0f\n", "", level, s[M_31K], s[M_250K],
+                       s[M_EMPH]);
+        }
+        printf("%7.0f %9.1f %9.1f %9.0f %9.0f %9.0f %9.0f%s\n", tau_us, ripple(32), ripple(4),
+               worst[M_31K], worst[M_250K], worst[M_EMPH], full,
+               tau_us == CV_RC_US ? "  <- CV_RC_US" : "");
+        if (tau_us == CV_RC_US && worst[M_EMPH] > worst[M_250K])
+            fail = 1;
+    }
+    return fail;
+
+usage:
+    fprintf(stderr, "usage: %s [-t US] [-v]\n", argv[0]);
+    return 2;
+}
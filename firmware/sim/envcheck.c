@@ -0,0 +1,260 @@
+// envcheck - control-rate envelopes against the per-sample reference
+//
+// Builds synthesizer/voices.h natively (HOST_SIM) and triggers each voice
+// at full accent across the DECAY pot's travel. Alongside the mixer ISR it
+// steps a model of the envelopes as they ran before the control stage:
+// decay and pitch sweep on every env tick, in the same fixed point (sweeps
+// landing on their end points), with the decay steps spread evenly at the
+// nominal rate of set_param_decay()'s pot mapping. Each case is run with
+// the trigger on every control slot; per case it reports the worst of:
+//   env    worst level difference (dB) while the reference is above -40dB
+//   t40    time to fall 40dB below the trigger level, firmware vs reference
+//   phase  kick/tom worst accumulated phase difference until t40 (degrees).
+//          Sweeps move in steps of half a control tick, so the pitch
+//          contour runs slightly ahead of the reference; comparing phase
+//          rather than momentary pitch measures what that does to the
+//          waveform.
+//
+// Usage: envcheck [-e DB] [-t PCT] [-d DEG] [-v]
+//   -e DB     envelope tolerance (default 1.5 dB)
+//   -t PCT    t40 tolerance (default 5 %)
+//   -d DEG    phase tolerance (default 90 degrees)
+//   -v        per-millisecond trace of the first failing case
+//
+// Exit status is 1 if any case is out of tolerance.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "../synthesizer/voices.h"
+
+uint8_t SREG, DDRB, PORTB, PINB;
+uint8_t sim_pwm;
+uint32_t sim_clips;
+
+// Per-sample reference: old per env tick sweep rates
+#define REF_K_SWEEP_SHIFT (7 - ENV_SHIFT)
+#define REF_T_SWEEP_Q8 ((TONE_SCALE_Q12 * TONE_SCALE_Q12 / ENV_INC + 128) >> 8)
+
+#define MAX_SAMPLES (MIX_RATE * 4)  // Longest decay is ~2 s
+#define MS_SAMPLES (MIX_RATE / 1000)
+
+enum { C_KICK, C_SNARE, C_HIHAT_CLOSED, C_HIHAT_OPEN, C_CLAP, C_TOM, C_COWBELL, C_COUNT };
+static const char *case_names[C_COUNT] = {
+    "kick", "snare", "hihat-c", "hihat-o", "clap", "tom", "cowbell"
+};
+static const uint8_t case_voice[C_COUNT] = { 0, 1, 2, 2, 3, 4, 5 };
+
+typedef struct {
+    double env_db;    // Worst |level difference|
+    double t40_fw;    // ms
+    double t40_ref;   // ms
+    double phase_deg; // Worst |accumulated phase difference| (kick/tom)
+} result_t;
+
+static double tol_env = 1.5, tol_t40 = 5.0, tol_phase = 90.0;
+static int verbose;
+
+// Nominal decay steps per env tick for the case at a DECAY pot setting
+static double env_rate(int c, uint8_t pot)
+{
+    int rate = 176 - (pot * 3 + 4) / 8;
+    if (c != C_KICK) {
+        rate += DECAY_LOG_OCTAVE;
+        if (rate > 192) rate = 192;
+    }
+    if (c == C_HIHAT_CLOSED && rate > 192) rate = 192;
+    if (c == C_HIHAT_OPEN && rate > 128) rate = 128;
+    rate = DECAY_LOG(rate);
+    if (rate > DECAY_LOG_MAX) rate = DECAY_LOG_MAX;
+    return pow(2.0, (double)rate / DECAY_LOG_OCTAVE - 4) / CTRL_SLOTS;
+}
+
+static uint16_t ref_decay(uint16_t vol, uint8_t shift)
+{
+    uint16_t d = vol >> shift;
+    if (d == 0 && vol > 0)
+        d = 1;
+    return (vol > d) ? vol - d : 0;
+}
+
+// Level of the case's voice (snare: the louder of its two envelopes)
+static uint16_t fw_level(int c)
+{
+    switch (c) {
+    case C_KICK: return k_vol;
+    case C_SNARE: return s_vol > s_tone_vol ? s_vol : s_tone_vol;
+    case C_HIHAT_CLOSED:
+    case C_HIHAT_OPEN: return h_vol;
+    case C_CLAP: return c_vol;
+    case C_TOM: return t_vol;
+    default: return cb_vol;
+    }
+}
+
+static double db(double a, double b)
+{
+    return 20.0 * log10((a < 1 ? 1 : a) / b);
+}
+
+static result_t run_case(int c, uint8_t pot, uint8_t slot, int trace)
+{
+    result_t r = { 0 };
+    uint16_t vol = 0, vol2 = 0, step = 0;
+    uint8_t frac = 0;
+    double due = 0;
+    double sum_fw = 0, sum_ref = 0, phase = 0;
+    uint32_t t40_fw = 0, t40_ref = 0;
+
+    voice_active = 0;
+    ctrl_slot = slot;
+    set_param_decay(pot);
+    set_param_tone(470 + 128 * 6);  // TONE pot at mid travel
+    current_voice = case_voice[c];
+    if (c == C_HIHAT_CLOSED) h_decay_speed = DECAY_LOG(192);
+    if (c == C_HIHAT_OPEN) h_decay_speed = DECAY_LOG(128);
+    update_hihat_decay();
+    trigger_current_voice_with_accent(65535);
+
+    // Reference starts from the trigger state
+    switch (c) {
+    case C_KICK: vol = k_vol; step = k_step; break;
+    case C_SNARE: vol = s_vol; vol2 = s_tone_vol; break;
+    case C_HIHAT_CLOSED:
+    case C_HIHAT_OPEN: vol = h_vol; break;
+    case C_CLAP: vol = c_vol; break;
+    case C_TOM: vol = t_vol; step = t_step; break;
+    case C_COWBELL: vol = cb_vol; break;
+    }
+    double start = vol > vol2 ? vol : vol2;
+    double floor40 = start / 100.0;
+    double nominal = env_rate(c, pot), rate;
+    uint8_t shift = 0, shift2 = 0;
+
+    for (uint32_t n = 1; n <= MAX_SAMPLES; n++) {
+        TIMER0_COMPA_vect();
+
+#ifdef ENV_FRACTIONAL
+        int tick = (voice_active & V_ENV) != 0;
+#else
+        int tick = 1;
+#endif
+        if (tick) {
+            rate = nominal;
+            switch (c) {
+            case C_KICK:
+                if (step > k_tone_end) {
+                    uint16_t sweep = step >> REF_K_SWEEP_SHIFT;
+                    step -= sweep ? sweep : 1;
+                    if (step < k_tone_end) step = k_tone_end;
+                }
+                shift = K_DECAY_SHIFT; break;
+            case C_SNARE: shift = S_NOISE_SHIFT; shift2 = S_TONE_SHIFT; break;
+            case C_HIHAT_CLOSED:
+            case C_HIHAT_OPEN: shift = H_DECAY_SHIFT; break;
+            case C_CLAP: shift = C_DECAY_SHIFT; if (c_stutter) rate = 0; break;
+            case C_TOM:
+                if (step > t_tone_end) {
+                    uint16_t f = frac + (REF_T_SWEEP_Q8 & 0xFF);
+                    step -= (REF_T_SWEEP_Q8 >> 8) + (f >> 8);
+                    frac = f;
+                    if (step < t_tone_end) step = t_tone_end;
+                }
+                shift = T_DECAY_SHIFT; break;
+            case C_COWBELL: shift = CB_DECAY_SHIFT; break;
+            }
+            for (due += rate; due >= 1.0; due -= 1.0) {
+                vol = ref_decay(vol, shift);
+                if (c == C_SNARE) vol2 = ref_decay(vol2, shift2);
+            }
+        }
+
+        uint16_t ref = vol > vol2 ? vol : vol2;
+        uint16_t fw = fw_level(c);
+        if (ref >= floor40) {
+            double d = fabs(db(fw, ref));
+            if (d > r.env_db) r.env_db = d;
+        }
+        if (c == C_KICK || c == C_TOM) {
+            uint16_t fw_step = (c == C_KICK) ? k_step : t_step;
+            sum_fw += fw_step;
+            sum_ref += step;
+            if (!t40_ref) {
+                phase += ((double)fw_step - step) * 360.0 / 65536.0;
+                if (fabs(phase) > r.phase_deg) r.phase_deg = fabs(phase);
+            }
+        }
+        if (!t40_ref && ref < floor40) t40_ref = n;
+        if (!t40_fw && fw < floor40) t40_fw = n;
+
+        if (n % MS_SAMPLES == 0) {
+            if (trace)
+                printf("  %5.0f ms  fw %5u  ref %5u  %+6.2f dB  step fw %7.1f ref %7.1f\n",
+                       (double)n / MS_SAMPLES, fw, ref, db(fw, ref),
+                       sum_fw / MS_SAMPLES, sum_ref / MS_SAMPLES);
+            sum_fw = sum_ref = 0;
+        }
+        if (t40_fw && t40_ref && !trace) break;
+    }
+
+    r.t40_fw = (t40_fw ? t40_fw : MAX_SAMPLES) * 1000.0 / MIX_RATE;
+    r.t40_ref = (t40_ref ? t40_ref : MAX_SAMPLES) * 1000.0 / MIX_RATE;
+    return r;
+}
+
+int main(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        if (a[0] != '-') goto usage;
+        if (a[1] == 'v') { verbose = 1; continue; }
+        if (i + 1 >= argc) goto usage;
+        double v = atof(argv[++i]);
+        switch (a[1]) {
+        case 'e': tol_env = v; break;
+        case 't': tol_t40 = v; break;
+        case 'd': tol_phase = v; break;
+        default: goto usage;
+        }
+    }
+
+    static const uint8_t pots[] = { 0, 42, 85, 127, 170, 212, 255 };
+    int fails = 0, traced = 0;
+
+    printf("SAMPLE_RATE %d (actual %d Hz), %d control slots\n", SAMPLE_RATE, MIX_RATE, CTRL_SLOTS);
+    printf("case      decay  env dB   t40 fw/ref ms     t40 %%  phase deg\n");
+    for (int c = 0; c < C_COUNT; c++) {
+        for (unsigned p = 0; p < sizeof(pots); p++) {
+            // Worst over the control slot the trigger lands on
+            result_t r = { 0 };
+            uint8_t worst_slot = 0;
+            for (uint8_t slot = 0; slot < CTRL_SLOTS; slot++) {
+                result_t rs = run_case(c, pots[p], slot, 0);
+                if (rs.env_db > r.env_db) r.env_db = rs.env_db;
+                if (rs.phase_deg > r.phase_deg) r.phase_deg = rs.phase_deg;
+                if (slot == 0 || fabs(rs.t40_fw - rs.t40_ref) > fabs(r.t40_fw - r.t40_ref)) {
+                    r.t40_fw = rs.t40_fw;
+                    r.t40_ref = rs.t40_ref;
+                    worst_slot = slot;
+                }
+            }
+            double t40 = 100.0 * (r.t40_fw - r.t40_ref) / r.t40_ref;
+            int bad = r.env_db > tol_env || fabs(t40) > tol_t40 ||
+                      r.phase_deg > tol_phase;
+            printf("%-9s %5u  %6.2f  %7.1f / %7.1f  %+6.2f  %9.1f%s\n",
+                   case_names[c], pots[p], r.env_db, r.t40_fw, r.t40_ref, t40,
+                   r.phase_deg, bad ? "  FAIL" : "");
+            if (bad && verbose && !traced++)
+                run_case(c, pots[p], worst_slot, 1);
+            fails += bad;
+        }
+    }
+    printf("tolerance: env %.2f dB, t40 %.1f %%, phase %.0f deg: %s\n",
+           tol_env, tol_t40, tol_phase, fails ? "FAIL" : "ok");
+    return fails ? 1 : 0;
+
+usage:
+    fprintf(stderr, "usage: %s [-e DB] [-t PCT] [-d DEG] [-v]\n", argv[0]);
+    return 2;
+}
@@ -0,0 +1,75 @@
+#ifndef HOST_H
+#define HOST_H
+
+// --- Native Hardware Stand-in (HOST_SIM builds) ---
+// Provides everything sequencer/hardware.h provides on the chip. seqsim.c
+// implements it against a virtual clock: read_adc() returns the scripted
+// button voltage and the EEPROM API works on an in-memory image.
+
+#include <stdint.h>
+
+#define ISR(vector, ...) void vector(void)
+#define sei() ((void)0)
+#define cli() ((void)0)
+extern uint8_t SREG;
+
+#define BTN_CH 3
+#define TICK_PRESCALER 64  // Timer0 1ms tick (../common/clock.h)
+#define PWM_HZ 31250UL     // Timer1 PWM / overflow rate
+
+// --- PWM Outputs ---
+extern uint8_t sim_led;  // OCR1A
+extern uint8_t sim_cv;   // OCR1B
+#define LED_PWM sim_led
+#define CV_PWM sim_cv
+
+void setup_hardware(void);
+uint8_t read_adc(uint8_t channel);
+
+// --- EEPROM (avr/eeprom.h subset used by the firmware) ---
+uint8_t eeprom_read_byte(const uint8_t *addr);
+uint32_t eeprom_read_dword(const uint32_t *addr);
+void eeprom_update_byte(uint8_t *addr, uint8_t value);
+void eeprom_update_dword(uint32_t *addr, uint32_t value);
+
+// --- MIDI Out (MIDI=1): the line is sim_usidr's MSB ---
+// seqsim calls TIMER1_OVF_vect() every 32 us while sim_bitclk is set.
+extern uint8_t sim_usidr;
+extern uint8_t sim_bitclk;
+#define MIDI_BITCLK_vect TIMER1_OVF_vect
+
+static inline void midi_usi_init(void) { sim_usidr = 0xFF; }
+static inline void midi_usi_load(uint8_t b) { sim_usidr = b; }
+static inline void midi_usi_shift(void) { sim_usidr = (sim_usidr << 1) | 1; }
+static inline void midi_bitclk_on(void) { sim_bitclk = 1; }
+static inline void midi_bitclk_off(void) { sim_bitclk = 0; }
+
+// --- CV Emphasis Timer (FASTCV=1): sim_emph counts left, 0 when off ---
+// seqsim ends the emphasis (TIMER0_COMPB_vect()) at the next ISR or loop
+// pass; CV_EMPH_US is the 8MHz profile's Timer0 count.
+extern uint8_t sim_emph;
+#define CV_EMPH_vect TIMER0_COMPB_vect
+#define CV_EMPH_US 8.0
+#define CV_EMPH_MAX 124
+
+static inline uint8_t cv_emph_start(uint8_t n) { sim_emph = n; return 1; }
+static inline void cv_emph_stop(void) { sim_emph = 0; }
+
+#define PROGMEM
+#define pgm_read_byte(p) (*(const uint8_t *)(p))
+
+// avr-gcc builtin: bit i of the result is bit (map >> 4i) & 0xF of bits,
+// or bit i of val where that nibble is 0xF
+static inline uint8_t host_insert_bits(uint32_t map, uint8_t bits, uint8_t val)
+{
+    uint8_t r = 0;
+    for (int i = 0; i < 8; i++) {
+        uint8_t n = (map >> (4 * i)) & 0xF;
+        uint8_t b = (n == 0xF) ? (val >> i) & 1 : (bits >> n) & 1;
+        r |= b << i;
+    }
+    return r;
+}
+#define __builtin_avr_insert_bits host_insert_bits
+
+#endif // HOST_H
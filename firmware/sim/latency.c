@@ -0,0 +1,236 @@
+// latency - step CV to audible onset, for the sequencer's CV_LOOKAHEAD
+//
+// Models the chain from the sequencer writing a step's CV to the synth's
+// output reaching it, on one virtual time line:
+//   CV      OCR1B = level at t = 0 (31.25kHz PWM, or 250kHz with -F),
+//           one-pole RC of -t us, exact per PWM edge
+//   synth   main.c's loop: a CV read per pass (sampled 12 us into its
+//           104 us conversion; passes 110 us apart, the pot reads add 208 us
+//           every 256th), cv_detect() from synthesizer/trigger.h, the
+//           trigger at main.c's accent and its accent window
+//   voice   synthesizer/voices.h built natively (HOST_SIM), the mixer ISR
+//           once per sample; TONE and DECAY pots at mid travel
+// Onset is the start of the first 0.25 ms block whose RMS (about the idle
+// output) is within 6 dB of the loudest in the first 50 ms: where the hit
+// is heard to land.
+// Each voice is run at -n phases of the synth loop against the CV write;
+// oscillators run free between runs, as they do on the chip.
+//
+// Per voice: detect (CV write to trigger), attack (trigger to onset) and
+// total, mean and worst. The recommended CV_LOOKAHEAD is the mean total
+// for the voice given with -v, rounded to whole 1 ms ticks.
+//
+// Usage: latency [-v VOICE] [-c CV] [-t US] [-F] [-n N] [-q]
+//   -v VOICE  kick|snare|hihat|clap|tom|cowbell (default kick)
+//   -c CV     step level, 11-255 (default 255: LFO depth 0)
+//   -t US     CV filter time constant (default 220)
+//   -F        FASTCV build: 250kHz PWM
+//   -n N      phases per voice (default 64)
+//   -q        print only the recommended CV_LOOKAHEAD (for make)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "../synthesizer/voices.h"
+#include "../synthesizer/trigger.h"
+
+uint8_t SREG, DDRB, PORTB, PINB;
+uint8_t sim_pwm;
+uint32_t sim_clips;
+
+#define VCC 5.0
+#define PASS_US 110.0            // CV read + loop
+#define POT_US 208.0             // Two more reads every 256 passes
+#define SAMPLE_US 12.0           // 1.5 ADC clocks of 8 us
+#define CONV_US 104.0
+#define ACCENT_WINDOW 8          // synthesizer/main.c defaults
+#define CV_GATE_MS 10            // sequencer/main.c
+#define ONSET_MS 50
+#define SAMPLE_PERIOD_US (1e6 / MIX_RATE)
+#define BLOCK_SAMPLES (MIX_RATE / 4000)   // 0.25 ms
+
+static const char *voice_names[] = { "kick", "snare", "hihat", "clap", "tom", "cowbell" };
+#define VOICE_COUNT 6
+
+static double tau_us = 220;
+static double pwm_us = 32;
+static uint8_t level = 255;
+
+// synthesizer/main.c
+static uint16_t cv_accent(uint8_t cv)
+{
+    return 16384 + ((uint16_t)(cv - CV_THRESHOLD_ON) * 200);
+}
+
+// RC output at t (us) for OCR1B = level from t = 0, settled at 0V before
+static double rc_at(double t)
+{
+    if (t <= 0)
+        return 0;
+    uint32_t periods = (uint32_t)(t / pwm_us);
+    double high = pwm_us * level / 256, low = pwm_us - high;
+    double eh = exp(-high / tau_us), el = exp(-low / tau_us);
+    // Start-of-period voltage follows v' = (VCC + (v - VCC) eh) el: closed form
+    double a = (VCC - VCC * eh) * el, b = eh * el;
+    double vinf = a / (1 - b);
+    double v = vinf * (1 - pow(b, periods));
+    double off = t - periods * pwm_us;
+    if (off < high)
+        return VCC + (v - VCC) * exp(-off / tau_us);
+    return (VCC + (v - VCC) * eh) * exp(-(off - high) / tau_us);
+}
+
+static uint8_t adc(double v)
+{
+    int r = (int)(v * 256 / VCC);
+    return r > 255 ? 255 : r;
+}
+
+typedef struct {
+    double detect, attack;
+} run_t;
+
+// One hit: the synth loop starts at phase_us before the CV write
+static run_t run(int voice, double phase_us, int pass0, uint8_t idle)
+{
+    run_t r = { -1, -1 };
+    current_voice = voice;
+    cv_state = CV_IDLE;
+
+    double t_read = -phase_us;   // Start of the current conversion
+    int pass = pass0;
+    uint8_t window = 0, cv_first = 0, cv_peak = 0;
+    double t_trig = -1;
+
+    static uint8_t out[MIX_RATE * ONSET_MS / 1000];
+    uint32_t n_out = 0, n_max = sizeof(out);
+    double t_sample = 0;
+
+    while (n_out < n_max && t_sample < 100000) {  // Gives up 100 ms in
+        // Loop passes that finish before this sample
+        while (t_read + CONV_US <= t_sample) {
+            uint8_t cv = adc(rc_at(t_read + SAMPLE_US));
+            if (cv_detect(cv)) {
+                trigger_current_voice_with_accent(cv_accent(cv));
+                cv_first = cv_peak = cv;
+                window = ACCENT_WINDOW;
+                if (t_trig < 0)
+                    t_trig = t_read + CONV_US;
+            } else if (window) {
+                if (cv > cv_peak)
+                    cv_peak = cv;
+                if (--window == 0 && cv_peak > cv_first)
+                    rescale_current_voice(cv_accent(cv_first), cv_accent(cv_peak));
+            }
+            t_read += PASS_US;
+            if ((pass++ & 0xFF) == 0xFF)
+                t_read += POT_US;
+        }
+        TIMER0_COMPA_vect();
+        if (t_trig >= 0)
+            out[n_out++] = sim_pwm;
+        t_sample += SAMPLE_PERIOD_US;
+    }
+
+    // Onset: first block within 6 dB of the loudest
+    double block[MIX_RATE * ONSET_MS / 1000 / BLOCK_SAMPLES], loudest = 0;
+    uint32_t n_blocks = n_out / BLOCK_SAMPLES;
+    for (uint32_t b = 0; b < n_blocks; b++) {
+        double sum = 0;
+        for (uint32_t i = b * BLOCK_SAMPLES; i < (b + 1) * BLOCK_SAMPLES; i++)
+            sum += (double)(out[i] - idle) * (out[i] - idle);
+        block[b] = sqrt(sum / BLOCK_SAMPLES);
+        if (block[b] > loudest) loudest = block[b];
+    }
+    for (uint32_t b = 0; b < n_blocks && loudest > 0; b++) {
+        if (block[b] * 2 >= loudest) {
+            r.detect = t_trig;
+            // Samples are counted from the first one after the trigger
+            double first = ceil(t_trig / SAMPLE_PERIOD_US) * SAMPLE_PERIOD_US;
+            r.attack = first + b * BLOCK_SAMPLES * SAMPLE_PERIOD_US - t_trig;
+            break;
+        }
+    }
+
+    // Let the voice die away (oscillators keep running) before the next hit
+    for (uint32_t i = 0; i < (uint32_t)MIX_RATE * 3 && (voice_active & ~V_ENV); i++)
+        TIMER0_COMPA_vect();
+    return r;
+}
+
+int main(int argc, char **argv)
+{
+    int pick = 0, n_phases = 64, quiet = 0;
+
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        if (!strcmp(a, "-F")) { pwm_us = 4; continue; }
+        if (!strcmp(a, "-q")) { quiet = 1; continue; }
+        if (a[0] != '-' || i + 1 >= argc) goto usage;
+        const char *v = argv[++i];
+        switch (a[1]) {
+        case 'v':
+            for (pick = 0; pick < VOICE_COUNT && strcmp(v, voice_names[pick]); pick++);
+            if (pick == VOICE_COUNT) goto usage;
+            break;
+        case 'c': level = atoi(v); break;
+        case 't': tau_us = atof(v); break;
+        case 'n': n_phases = atoi(v); break;
+        default: goto usage;
+        }
+    }
+    if (level <= CV_THRESHOLD_ON || tau_us <= 0 || n_phases < 1) goto usage;
+
+    set_param_decay(128);
+    set_param_tone(470 + 128 * 6);
+    update_hihat_decay();
+    for (int i = 0; i < MIX_RATE / 10; i++)
+        TIMER0_COMPA_vect();
+    uint8_t idle = sim_pwm;
+
+    double mean_total[VOICE_COUNT];
+    if (!quiet) {
+        printf("CV %u, tau %.0f us, %s PWM, %d phases (ms)\n", level, tau_us,
+               pwm_us < 32 ? "250kHz" : "31.25kHz", n_phases);
+        printf("%-8s %13s %13s %13s\n", "", "detect", "attack", "total");
+        printf("%-8s %6s %6s %6s %6s %6s %6s\n", "voice", "mean", "max", "mean", "max", "mean",
+               "max");
+    }
+    for (int v = 0; v < VOICE_COUNT; v++) {
+        double sum_d = 0, sum_a = 0, max_d = 0, max_a = 0, max_t = 0;
+        int n = 0;
+        for (int p = 0; p < n_phases; p++) {
+            run_t r = run(v, PASS_US * p / n_phases, (p * 37) & 0xFF, idle);
+            if (r.detect < 0) continue;
+            n++;
+            sum_d += r.detect;
+            sum_a += r.attack;
+            if (r.detect > max_d) max_d = r.detect;
+            if (r.attack > max_a) max_a = r.attack;
+            if (r.detect + r.attack > max_t) max_t = r.detect + r.attack;
+        }
+        if (!n) {
+            fprintf(stderr, "latency: %s never triggered\n", voice_names[v]);
+            return 2;
+        }
+        mean_total[v] = (sum_d + sum_a) / n / 1000;
+        if (!quiet)
+            printf("%-8s %6.2f %6.2f %6.2f %6.2f %6.2f %6.2f\n", voice_names[v],
+                   sum_d / n / 1000, max_d / 1000, sum_a / n / 1000, max_a / 1000,
+                   mean_total[v], max_t / 1000);
+    }
+
+    int ticks = (int)(mean_total[pick] + 0.5);
+    if (ticks > CV_GATE_MS - 1) ticks = CV_GATE_MS - 1;
+    if (quiet)
+        printf("%d\n", ticks);
+    else
+        printf("Recommended for %s: CV_LOOKAHEAD=%d\n", voice_names[pick], ticks);
+    return 0;
+
+usage:
+    fprintf(stderr, "usage: %s [-v VOICE] [-c CV] [-t US] [-F] [-n N] [-q]\n", argv[0]);
+    return 2;
+}
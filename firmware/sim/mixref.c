@@ -0,0 +1,29 @@
+// mixref - the C mixer of synthesizer/voices.h as a shared library
+//
+// tools/mixcheck.py loads it with ctypes and runs it beside mixer.S on
+// tools/avrasm.py: it copies the C globals into the simulated SRAM (and the
+// reserved registers), runs both ISRs and compares every global and OCR1A.
+// Build: make mixref.so (same options as mixcheck).
+
+#include "../synthesizer/voices.h"
+
+uint8_t SREG, DDRB, PORTB, PINB;
+uint8_t sim_pwm;
+uint32_t sim_clips;
+
+void ref_isr(void) { TIMER0_COMPA_vect(); }
+
+void ref_trigger(uint8_t voice, uint16_t accent)
+{
+    current_voice = voice;
+    trigger_current_voice_with_accent(accent);
+}
+
+void ref_set_tone(uint16_t tone) { set_param_tone(tone); }
+void ref_set_decay(uint8_t pot) { set_param_decay(pot); }
+
+void ref_hihat_open(uint8_t open)
+{
+    h_decay_speed = open ? DECAY_LOG(128) : DECAY_LOG(192);
+    update_hihat_decay();
+}
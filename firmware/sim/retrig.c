@@ -0,0 +1,256 @@
+// retrig - shortest inter-trigger interval the synth's CV input resolves
+//
+// Models the CV path end to end and runs synthesizer/trigger.h against the
+// plain threshold detector it replaced (RETRIGGER=0):
+//   source  sequencer PWM on OC1B, 31250 Hz, duty changes at TOP
+//   filter  one-pole RC (time constant -t), exact per PWM edge, so the
+//           ripple is included
+//   synth   one CV read per main loop pass: 104 us conversion (sampled
+//           1.5 ADC clocks in) + 6 us, and the two pot reads every 256th
+//           pass; +-1 count of ADC noise
+// A burst of -n triggers at interval I is sent at each start phase (-p of
+// them, spread over a loop pass and the pot read position). Each pulse is
+// high for -g percent of I, or, with -d, low for only that many us before
+// the next one. A burst resolves when every pulse gives exactly one
+// trigger before the next pulse starts. The interval is scanned down from
+// 30 ms; the minimum resolvable interval is the last one before the first
+// failure.
+//
+// Usage: retrig [-t US] [-c CV] [-g PCT | -d US] [-n N] [-p N]
+//   -t US     RC time constant (default: 100, 220, 470, 1000)
+//   -c CV     pulse level in ADC counts (default: 32, 96, 160, 255)
+//   -g PCT    gate length as a percentage of the interval (default 50)
+//   -d US     fixed dip before each pulse instead of -g
+//   -n N      pulses per burst (default 8)
+//   -p N      start phases per interval (default 16)
+//
+// Exit status is 1 if the slope detector misses anything the threshold
+// detector resolves, or retriggers on a steady gate.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "../synthesizer/trigger.h"
+
+#define PWM_US 32.0              // 31250 Hz
+#define VCC 5.0
+#define PASS_US 110.0            // CV read + loop
+#define POT_US 208.0             // Two more reads every 256 passes
+#define SAMPLE_US 12.0           // 1.5 ADC clocks of 8 us
+#define CONV_US 104.0
+
+static double tau_us;
+static int gate_pct = 50;
+static double dip_us = 0;
+static int n_pulses = 8;
+static int n_phases = 16;
+
+// --- Source + RC ---
+// Pulse k starts on the PWM period at or after k * interval
+static double interval_us;
+static uint8_t level;
+static double start_us = 2000;
+
+static uint8_t duty_at(uint32_t period)
+{
+    double t = period * PWM_US - start_us;
+    if (t < 0)
+        return 0;
+    int k = (int)(t / interval_us);
+    if (k >= n_pulses)
+        return 0;
+    double off = t - k * interval_us;
+    double high = dip_us > 0 ? interval_us - dip_us : interval_us * gate_pct / 100;
+    if (dip_us > 0 && k == n_pulses - 1)
+        high = interval_us / 2;
+    return off < high ? level : 0;
+}
+
+static uint32_t rc_period;       // Start of the current PWM period
+static double rc_v;              // Volts at rc_period
+
+static double rc_at(double t_us)
+{
+    uint32_t p = (uint32_t)(t_us / PWM_US);
+    for (; rc_period < p; rc_period++) {
+        double high = PWM_US * duty_at(rc_period) / 256;
+        rc_v = VCC + (rc_v - VCC) * exp(-high / tau_us);
+        rc_v *= exp(-(PWM_US - high) / tau_us);
+    }
+    double off = t_us - p * PWM_US;
+    double high = PWM_US * duty_at(p) / 256;
+    if (off < high)
+        return VCC + (rc_v - VCC) * exp(-off / tau_us);
+    double v = VCC + (rc_v - VCC) * exp(-high / tau_us);
+    return v * exp(-(off - high) / tau_us);
+}
+
+static uint32_t noise = 1;
+
+static uint8_t adc(double v)
+{
+    noise = noise * 1103515245 + 12345;
+    int r = (int)(v * 256 / VCC) + (int)((noise >> 16) % 3) - 1;
+    return r < 0 ? 0 : r > 255 ? 255 : r;
+}
+
+// --- Detectors ---
+static uint8_t old_state;
+
+// synthesizer/main.c before trigger.h (and RETRIGGER=0)
+static uint8_t old_detect(uint8_t cv)
+{
+    uint8_t s = old_state;
+    if (cv > CV_THRESHOLD_ON)
+        s = 1;
+    else if (cv < CV_THRESHOLD_OFF)
+        s = 0;
+    uint8_t trig = s && !old_state;
+    old_state = s;
+    return trig;
+}
+
+// One burst; 1 if every pulse triggered exactly once
+static int burst(int slope, double phase_us, int pass0)
+{
+    rc_period = 0;
+    rc_v = 0;
+    old_state = 0;
+    cv_state = CV_IDLE;
+
+    int hits[64] = { 0 };
+    int early = 0;
+    double end = start_us + n_pulses * interval_us + 20 * tau_us + 2000;
+    int pass = pass0;
+    for (double t = phase_us; t < end; pass++) {
+        uint8_t cv = adc(rc_at(t + SAMPLE_US));
+        uint8_t trig = slope ? cv_detect(cv) : old_detect(cv);
+        if (trig) {
+            // Pulse k's window runs from its first PWM period to pulse k+1's
+            double tt = t + CONV_US - start_us;
+            int k = tt < 0 ? -1 : (int)(tt / interval_us);
+            if (k < 0) early++;
+            else if (k >= n_pulses) hits[n_pulses - 1]++;
+            else hits[k]++;
+        }
+        t += PASS_US;
+        if ((pass & 0xFF) == 0xFF)
+            t += POT_US;
+    }
+    if (early)
+        return 0;
+    for (int k = 0; k < n_pulses; k++)
+        if (hits[k] != 1)
+            return 0;
+    return 1;
+}
+
+static int resolves(int slope, double i_us)
+{
+    interval_us = i_us;
+    for (int p = 0; p < n_phases; p++) {
+        double phase = PASS_US * p / n_phases;
+        if (!burst(slope, phase, (p * 97) & 0xFF))
+            return 0;
+    }
+    return 1;
+}
+
+// Minimum resolvable interval in us (0: not even at 30 ms)
+static double min_interval(int slope)
+{
+    double last = 0;
+    for (double i = 30000; i >= 200; i -= (i > 5000 ? 500 : i > 1000 ? 100 : 20)) {
+        if (dip_us > 0 && i <= dip_us + PWM_US)
+            break;
+        if (!resolves(slope, i))
+            break;
+        last = i;
+    }
+    return last;
+}
+
+// A single long gate: must give one trigger, ripple and noise included
+static int steady(void)
+{
+    int saved = n_pulses;
+    n_pulses = 1;
+    interval_us = 50000;
+    int ok = 1;
+    for (int p = 0; p < n_phases && ok; p++)
+        ok = burst(1, PASS_US * p / n_phases, p * 97);
+    n_pulses = saved;
+    return ok;
+}
+
+static void print_ms(double us)
+{
+    if (us > 0)
+        printf(" %8.2f", us / 1000);
+    else
+        printf(" %8s", "-");
+}
+
+int main(int argc, char **argv)
+{
+    static const double taus[] = { 100, 220, 470, 1000 };
+    static const uint8_t levels[] = { 32, 96, 160, 255 };
+    double tau_arg = 0;
+    int cv_arg = 0;
+
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        if (a[0] != '-' || i + 1 >= argc) goto usage;
+        const char *v = argv[++i];
+        switch (a[1]) {
+        case 't': tau_arg = atof(v); break;
+        case 'c': cv_arg = atoi(v); break;
+        case 'g': gate_pct = atoi(v); break;
+        case 'd': dip_us = atof(v); break;
+        case 'n': n_pulses = atoi(v); break;
+        case 'p': n_phases = atoi(v); break;
+        default: goto usage;
+        }
+    }
+    if (tau_arg < 0 || cv_arg < 0 || cv_arg > 255 || (cv_arg && cv_arg <= CV_THRESHOLD_ON + 1))
+        goto usage;
+    if (gate_pct < 1 || gate_pct > 99 || dip_us < 0) goto usage;
+    if (n_pulses < 1 || n_pulses > 64 || n_phases < 1) goto usage;
+
+    if (dip_us > 0)
+        printf("dip %.0f us", dip_us);
+    else
+        printf("gate %d%%", gate_pct);
+    printf(", %d pulses x %d phases: minimum resolvable interval (ms)\n", n_pulses, n_phases);
+    printf("%8s %4s %8s %8s %s\n", "tau_us", "cv", "before", "after", "");
+
+    int fail = 0;
+    for (int t = 0; t < 4; t++) {
+        tau_us = tau_arg ? tau_arg : taus[t];
+        for (int c = 0; c < 4; c++) {
+            level = cv_arg ? cv_arg : levels[c];
+            double before = min_interval(0);
+            double after = min_interval(1);
+            int ok = steady();
+            printf("%8.0f %4u", tau_us, level);
+            print_ms(before);
+            print_ms(after);
+            if (!ok)
+                printf("  retriggers on a steady gate");
+            else if (before > 0 && (after == 0 || after > before))
+                printf("  worse");
+            printf("\n");
+            if (!ok || (before > 0 && (after == 0 || after > before)))
+                fail = 1;
+            if (cv_arg) break;
+        }
+        if (tau_arg) break;
+    }
+    return fail;
+
+usage:
+    fprintf(stderr, "usage: %s [-t US] [-c CV] [-g PCT | -d US] [-n N] [-p N]\n", argv[0]);
+    return 2;
+}
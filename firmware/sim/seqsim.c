@@ -0,0 +1,680 @@
+// seqsim - virtual-time host simulation of the sequencer firmware
+//
+// Builds sequencer/main.c natively (HOST_SIM) and runs it against a virtual
+// clock. The Timer0 ISR fires on every virtual millisecond; the main loop
+// advances the clock by what it would cost on the chip (one ADC conversion
+// per pass plus the rest of the loop, 3.4 ms per EEPROM byte written), so
+// stalls show up where they would on hardware. An hour of playing takes
+// about a second. The Boot line gives the first step and the first main
+// loop pass after reset, with the EEPROM writes made before that pass
+// (first boot, or converting the 8-bank layout).
+//
+// Usage: seqsim [options] [script]
+//   -t TIME   stop after TIME of virtual time (default: last event + 1 s)
+//   -j N      add N random presses per minute ("jam" mode)
+//   -s SEED   random seed for jam presses and ADC noise (default 1)
+//   -n LSB    ADC noise, uniform +/- LSB (default 0)
+//   -l US     main loop cost besides the ADC conversion (default 20 us)
+//   -e FILE   EEPROM image: loaded if present, saved at exit (default blank)
+//   -v        log mode/bank/BPM changes, EEPROM writes and missed presses
+//             (and MIDI messages other than clock in MIDI=1 builds)
+//
+// Built with `make MIDI=1`, Timer1 overflows every 32 us (one bit cell) run
+// the MIDI bit clock ISR while it is enabled, and a UART receiver decodes
+// the line. The report adds byte count, framing errors, bytes dropped from
+// the TX ring, notes, and each clock's offset from the 24 PPQN grid of the
+// step it belongs to (ISR latency on the chip is not modelled: host ISRs
+// run instantly, so the bit cells themselves are exact).
+// Built with `make FASTCV=1`, a CV pre-emphasis ends at the next tick or
+// loop pass (it is under 1 ms; the CV is only checked for being nonzero).
+// With CV_LOOKAHEAD (`make seqsim CV_LOOKAHEAD=n`) the Steps line adds how
+// far ahead of its step each CV went out.
+//
+// Script: one event per line, '#' starts a comment. TIME is in ms, or takes
+// an s/m/h suffix.
+//   TIME press A|B|M HOLD     hold a button (A 0 V, B 0.9 V, M 1.67 V)
+//   TIME volts V HOLD         hold any divider voltage (threshold checks)
+//   TIME expect FIELD VALUE   check pattern/bank/pending/bpm/mode/step/dirty/
+//                             wave/rate/depth, or gate (1 while the CV is high)
+//   TIME end                  stop here
+//
+// Exit status is 1 if an expect failed or a press was missed.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "../sequencer/main.c"
+
+// --- Hardware Model ---
+#define SIM_VCC 5.0
+#define SIM_IDLE_V 5.0        // No button: pulled up to VCC
+#define ADC_CONV_US 104       // 13 ADC clocks at 8MHz / 64
+#define EE_WRITE_US 3400      // Erase + write, per byte
+#define EE_SIZE 512
+#define EE_ENDURANCE 100000.0 // Write cycles per cell
+
+static const double btn_volts[] = { SIM_IDLE_V, 0.0, 0.9, 1.67 }; // NONE, A, B, M
+static const char btn_names[] = "-ABM";
+static const char *mode_names[] = { "PLAY", "BANK", "TEMPO", "LFO_RATE", "LFO_DEPTH", "ETC" };
+
+uint8_t sim_led;
+uint8_t sim_cv;
+uint8_t SREG;
+uint8_t sim_usidr = 0xFF;
+uint8_t sim_bitclk;
+uint8_t sim_emph;
+
+// --- Virtual Clock ---
+static uint64_t now_us;
+static uint64_t next_tick_us = 1000;
+static uint32_t now_ms;
+static uint32_t stop_ms;
+static uint32_t loop_us = 20;
+static uint8_t timer_running;
+
+// --- Inputs ---
+static double in_volts = SIM_IDLE_V;
+static uint32_t release_ms;
+static int noise_lsb;
+static int verbose;
+
+// --- Script ---
+enum { EV_PRESS, EV_VOLTS, EV_EXPECT, EV_END };
+
+typedef struct {
+    uint32_t t;
+    uint32_t hold;
+    uint32_t value;
+    double volts;
+    int line;       // 0 = jam press
+    uint8_t kind;
+    uint8_t btn;
+    uint8_t seen;
+    char field[16];
+} event_t;
+
+static event_t *events;
+static size_t n_events, cap_events, next_event;
+static long active_press = -1;
+static unsigned expect_fail;
+
+// --- Statistics ---
+static uint8_t eeprom[EE_SIZE];
+static uint32_t ee_cell_writes[EE_SIZE];
+static uint32_t ee_writes, ee_boot_writes;  // Boot: before the main loop
+
+static uint32_t steps, trigs, late_trigs;
+static uint8_t cv_high;
+static uint32_t cv_rise_ms;     // When the CV last went high
+static uint8_t cv_rise_isr;     // ... in the tick ISR (not a late press)
+static uint32_t lead_min = UINT32_MAX, lead_max;  // CV rise to its step
+static uint32_t first_step_ms, loop_first_us;  // Boot: from reset
+static uint32_t last_step_ms, period_min = UINT32_MAX, period_max;
+static double ideal_ms, drift_worst;
+
+static uint64_t midi_step_us;   // When the current step fired
+static uint8_t midi_step_bpm;   // Tempo it fired at
+
+static uint64_t loop_passes;
+static uint64_t loop_start_us, gap_max_us;
+static uint32_t gap_max_at;
+
+// xorshift32, so runs repeat across hosts
+static uint32_t rng = 1;
+static uint32_t sim_rand(void)
+{
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+}
+
+static void run_script(void);
+
+// --- Timer0 Compare Match B (FASTCV=1 CV emphasis) ---
+static void sim_emph_end(void)
+{
+#ifdef FASTCV
+    if (sim_emph) TIMER0_COMPB_vect();
+#endif
+}
+
+// --- Timer0 Compare Match (1 ms) ---
+static void sim_tick(void)
+{
+    now_ms++;
+    run_script();
+    if (!timer_running) return;
+
+    // CV went high since the last tick: a late press played from the main loop
+    if (sim_cv && !cv_high) {
+        late_trigs++;
+        cv_rise_ms = now_ms;
+        cv_rise_isr = 0;
+    }
+
+    uint8_t step = current_step;
+    TIMER0_COMPA_vect();
+    sim_emph_end();
+    if (sim_cv && !cv_high) {
+        cv_rise_ms = now_ms;  // On the step, or CV_LOOKAHEAD ticks before it
+        cv_rise_isr = 1;
+    }
+    cv_high = sim_cv != 0;
+    if (current_step == step) return;
+
+    // Step fired: compare against the ideal grid at the current BPM
+    double step_ms = 60000.0 / current_bpm / STEPS_PER_BEAT;
+    if (steps == 0) {
+        first_step_ms = now_ms;
+        ideal_ms = now_ms;
+    } else {
+        uint32_t period = now_ms - last_step_ms;
+        if (period < period_min) period_min = period;
+        if (period > period_max) period_max = period;
+        ideal_ms += step_ms;
+        double drift = now_ms - ideal_ms;
+        if (drift < 0) drift = -drift;
+        if (drift > drift_worst) drift_worst = drift;
+    }
+    last_step_ms = now_ms;
+    midi_step_us = next_tick_us - 1000;
+    midi_step_bpm = current_bpm;
+    steps++;
+    if (sim_cv) {
+        trigs++;
+        if (cv_rise_isr) {
+            uint32_t lead = now_ms - cv_rise_ms;
+            if (lead < lead_min) lead_min = lead;
+            if (lead > lead_max) lead_max = lead;
+        }
+    }
+}
+
+// --- MIDI Out (MIDI=1 builds) ---
+#ifdef MIDI
+#define MIDI_BIT_US 32
+static uint64_t next_ovf_us = MIDI_BIT_US;
+static uint32_t midi_bytes, midi_framing, midi_notes, midi_clocks;
+static uint32_t midi_clk_k;        // Clocks received in the current step
+static uint64_t midi_clk_step_us;  // Step they belong to
+static uint64_t midi_last_clk_us, midi_int_min = UINT64_MAX, midi_int_max;
+static double midi_clk_worst;      // Worst |offset| from the 24 PPQN grid (us)
+static uint32_t midi_clk_skipped;  // In steps where the tempo changed
+
+static void midi_rx(uint8_t b, uint64_t t)
+{
+    static uint8_t msg[3], n;
+    midi_bytes++;
+    if (b == MIDI_CLOCK) {
+        if (midi_clk_step_us != midi_step_us) {
+            midi_clk_step_us = midi_step_us;
+            midi_clk_k = 0;
+        }
+        midi_clocks++;
+        if (current_bpm != midi_step_bpm) {
+            // Tempo edit mid-step: there is no grid to compare against
+            midi_clk_skipped++;
+            midi_last_clk_us = 0;
+            midi_clk_k++;
+            return;
+        }
+        double grid = 60e6 / current_bpm / 24;
+        double off = (double)t - (midi_step_us + midi_clk_k * grid);
+        if (off < 0) off = -off;
+        if (off > midi_clk_worst) midi_clk_worst = off;
+        if (midi_last_clk_us) {
+            uint64_t d = t - midi_last_clk_us;
+            if (d < midi_int_min) midi_int_min = d;
+            if (d > midi_int_max) midi_int_max = d;
+        }
+        midi_last_clk_us = t;
+        midi_clk_k++;
+        return;
+    }
+    if (b == MIDI_START) {
+        if (verbose) printf("%9u ms  MIDI start\n", now_ms);
+        return;
+    }
+    // Channel messages, with running status
+    if (b & 0x80) {
+        msg[0] = b;
+        n = 1;
+        return;
+    }
+    msg[n++] = b;
+    if (n < 3) return;
+    n = 1;
+    if (msg[2]) midi_notes++;
+    if (verbose) printf("%9u ms  MIDI %02X %02X %02X\n", now_ms, msg[0], msg[1], msg[2]);
+}
+
+// Timer1 overflow: bit clock ISR, then sample the line once per bit cell
+static void sim_bitclk_tick(uint64_t t)
+{
+    static int rx_bit = -1;
+    static uint8_t rx;
+    static uint64_t rx_start;
+
+    if (!sim_bitclk && rx_bit < 0) return;
+    if (sim_bitclk) TIMER1_OVF_vect();
+    uint8_t line = sim_usidr >> 7;
+    if (rx_bit < 0) {
+        if (!line) {
+            rx_bit = 0;
+            rx = 0;
+            rx_start = t;
+        }
+    } else if (rx_bit < 8) {
+        rx |= line << rx_bit++;
+    } else {
+        if (line) midi_rx(rx, rx_start);
+        else midi_framing++;
+        rx_bit = -1;
+    }
+}
+#endif
+
+static void sim_advance(uint32_t us)
+{
+    now_us += us;
+#ifdef MIDI
+    for (;;) {
+        if (next_ovf_us < next_tick_us) {
+            if (next_ovf_us > now_us) break;
+            sim_bitclk_tick(next_ovf_us);
+            next_ovf_us += MIDI_BIT_US;
+        } else {
+            if (next_tick_us > now_us) break;
+            next_tick_us += 1000;
+            sim_tick();
+        }
+    }
+#else
+    while (now_us >= next_tick_us) {
+        next_tick_us += 1000;
+        sim_tick();
+    }
+#endif
+}
+
+// --- Hardware Stand-in (see host.h) ---
+void setup_hardware(void)
+{
+    sim_led = 0;
+    sim_cv = 0;
+    timer_running = 1;
+}
+
+uint8_t read_adc(uint8_t channel)
+{
+    (void)channel;
+    sim_advance(ADC_CONV_US);
+    int val = (int)(in_volts / SIM_VCC * 256.0);
+    if (noise_lsb) val += (int)(sim_rand() % (2 * noise_lsb + 1)) - noise_lsb;
+    if (val < 0) val = 0;
+    if (val > 255) val = 255;
+    return val;
+}
+
+uint8_t eeprom_read_byte(const uint8_t *addr)
+{
+    return eeprom[(uintptr_t)addr % EE_SIZE];
+}
+
+uint32_t eeprom_read_dword(const uint32_t *addr)
+{
+    uintptr_t a = (uintptr_t)addr;
+    uint32_t v = 0;
+    for (int i = 3; i >= 0; i--) v = (v << 8) | eeprom[(a + i) % EE_SIZE];
+    return v;
+}
+
+void eeprom_update_byte(uint8_t *addr, uint8_t value)
+{
+    uintptr_t a = (uintptr_t)addr % EE_SIZE;
+    if (eeprom[a] == value) return;
+    eeprom[a] = value;
+    ee_cell_writes[a]++;
+    ee_writes++;
+    if (!loop_passes) ee_boot_writes++;
+    if (verbose) printf("%9u ms  EEPROM [0x%02X] = 0x%02X\n", now_ms, (unsigned)a, value);
+    sim_advance(EE_WRITE_US);  // Main loop busy-waits; ISR keeps running
+}
+
+void eeprom_update_dword(uint32_t *addr, uint32_t value)
+{
+    uint8_t *p = (uint8_t *)addr;
+    for (int i = 0; i < 4; i++) eeprom_update_byte(p + i, value >> (8 * i));
+}
+
+// --- Script Events ---
+static event_t *new_event(void)
+{
+    if (n_events == cap_events) {
+        cap_events = cap_events ? cap_events * 2 : 64;
+        events = realloc(events, cap_events * sizeof(*events));
+        if (!events) { perror("realloc"); exit(2); }
+    }
+    event_t *e = &events[n_events++];
+    memset(e, 0, sizeof(*e));
+    return e;
+}
+
+static uint32_t parse_time(const char *s)
+{
+    char *end;
+    double v = strtod(s, &end);
+    if (end == s) { fprintf(stderr, "bad time '%s'\n", s); exit(2); }
+    if (*end == 's') v *= 1000;
+    else if (*end == 'm' && end[1] != 's') v *= 60000;
+    else if (*end == 'h') v *= 3600000;
+    return (uint32_t)v;
+}
+
+static void load_script(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) { perror(path); exit(2); }
+    char buf[256];
+    int line = 0;
+    while (fgets(buf, sizeof(buf), f)) {
+        line++;
+        char *hash = strchr(buf, '#');
+        if (hash) *hash = 0;
+        char t[32], cmd[16], a[32], b[32];
+        int n = sscanf(buf, "%31s %15s %31s %31s", t, cmd, a, b);
+        if (n <= 0) continue;
+
+        event_t *e = new_event();
+        e->t = parse_time(t);
+        e->line = line;
+        if (n == 4 && !strcmp(cmd, "press")) {
+            const char *p = strchr(btn_names + 1, a[0]);
+            if (!p || !a[0]) goto bad;
+            e->kind = EV_PRESS;
+            e->btn = p - btn_names;
+            e->hold = parse_time(b);
+        } else if (n == 4 && !strcmp(cmd, "volts")) {
+            e->kind = EV_VOLTS;
+            e->volts = atof(a);
+            e->hold = parse_time(b);
+        } else if (n == 4 && !strcmp(cmd, "expect")) {
+            e->kind = EV_EXPECT;
+            snprintf(e->field, sizeof(e->field), "%.15s", a);
+            e->value = strtoul(b, NULL, 0);
+        } else if (n == 2 && !strcmp(cmd, "end")) {
+            e->kind = EV_END;
+        } else {
+            goto bad;
+        }
+        continue;
+bad:
+        fprintf(stderr, "%s:%d: bad event\n", path, line);
+        exit(2);
+    }
+    fclose(f);
+}
+
+// Random presses, mostly pattern edits with the odd mode change and long hold
+static void add_jam(uint32_t per_min, uint32_t until)
+{
+    uint32_t t = 1000;
+    while (per_min) {
+        t += 20 + sim_rand() % (2 * 60000 / per_min);
+        if (t >= until) break;
+        event_t *e = new_event();
+        uint32_t r = sim_rand() % 100;
+        e->kind = EV_PRESS;
+        e->t = t;
+        e->btn = (r < 45) ? BTN_A : (r < 85) ? BTN_B : BTN_M;
+        e->hold = (sim_rand() % 20 == 0) ? 600 + sim_rand() % 900 : 15 + sim_rand() % 385;
+        t += e->hold;
+    }
+}
+
+static int event_cmp(const void *a, const void *b)
+{
+    const event_t *x = a, *y = b;
+    if (x->t != y->t) return (x->t < y->t) ? -1 : 1;
+    return x->line - y->line;
+}
+
+static uint32_t field_value(const char *field, int *ok)
+{
+    *ok = 1;
+    if (!strcmp(field, "pattern")) return pattern;
+    if (!strcmp(field, "bank")) return current_bank;
+    if (!strcmp(field, "pending")) return pending_bank;
+    if (!strcmp(field, "bpm")) return current_bpm;
+    if (!strcmp(field, "mode")) return current_mode;
+    if (!strcmp(field, "step")) return current_step;
+    if (!strcmp(field, "dirty")) return pattern_dirty;
+    if (!strcmp(field, "wave")) return lfo_wave;
+    if (!strcmp(field, "rate")) return lfo_rate;
+    if (!strcmp(field, "depth")) return lfo_depth;
+    if (!strcmp(field, "gate")) return sim_cv != 0;
+    *ok = 0;
+    return 0;
+}
+
+static void run_script(void)
+{
+    if (release_ms && now_ms >= release_ms) {
+        in_volts = SIM_IDLE_V;
+        release_ms = 0;
+    }
+    while (next_event < n_events && events[next_event].t <= now_ms) {
+        event_t *e = &events[next_event];
+        switch (e->kind) {
+        case EV_PRESS:
+            active_press = next_event;
+            in_volts = btn_volts[e->btn];
+            release_ms = now_ms + (e->hold ? e->hold : 1);
+            break;
+        case EV_VOLTS:
+            in_volts = e->volts;
+            release_ms = now_ms + (e->hold ? e->hold : 1);
+            break;
+        case EV_EXPECT: {
+            int ok;
+            uint32_t v = field_value(e->field, &ok);
+            if (!ok || v != e->value) {
+                printf("%9u ms  FAIL line %d: %s = 0x%X, expected 0x%X%s\n", now_ms, e->line,
+                       e->field, v, e->value, ok ? "" : " (unknown field)");
+                expect_fail++;
+            }
+            break;
+        }
+        case EV_END:
+            stop_ms = now_ms;
+            break;
+        }
+        next_event++;
+    }
+}
+
+// --- State Change Log (-v) ---
+static void log_changes(void)
+{
+    static uint8_t mode, bank, bpm, pending = BANK_NO_PENDING;
+    if (current_mode != mode) {
+        printf("%9u ms  mode %s\n", now_ms, mode_names[current_mode]);
+        mode = current_mode;
+    }
+    if (pending_bank != pending) {
+        if (pending_bank != BANK_NO_PENDING) printf("%9u ms  bank %u pending\n", now_ms, pending_bank);
+        pending = pending_bank;
+    }
+    if (current_bank != bank) {
+        printf("%9u ms  bank %u\n", now_ms, current_bank);
+        bank = current_bank;
+    }
+    if (current_bpm != bpm) {
+        printf("%9u ms  bpm %u\n", now_ms, current_bpm);
+        bpm = current_bpm;
+    }
+}
+
+// --- EEPROM Image ---
+static void eeprom_load(const char *path)
+{
+    memset(eeprom, 0xFF, sizeof(eeprom));
+    if (!path) return;
+    FILE *f = fopen(path, "rb");
+    if (!f) return;  // Fresh image, written at exit
+    size_t n = fread(eeprom, 1, sizeof(eeprom), f);
+    (void)n;
+    fclose(f);
+}
+
+static void eeprom_save(const char *path)
+{
+    if (!path) return;
+    FILE *f = fopen(path, "wb");
+    if (!f || fwrite(eeprom, 1, sizeof(eeprom), f) != sizeof(eeprom)) {
+        perror(path);
+        exit(2);
+    }
+    fclose(f);
+}
+
+// --- Report ---
+static unsigned report(double host_s)
+{
+    double hours = now_ms / 3600000.0;
+    printf("=== seqsim: %u ms virtual in %.2f s host (%.0fx real time) ===\n",
+           now_ms, host_s, host_s > 0 ? now_ms / 1000.0 / host_s : 0.0);
+
+    printf("Steps:     %u (%u triggers, %u from late presses)", steps, trigs, late_trigs);
+    if (steps > 1)
+        printf(", period %u..%u ms, drift vs BPM grid %+.1f ms (worst %.1f ms)",
+               period_min, period_max, last_step_ms - ideal_ms, drift_worst);
+    if (lead_max)
+        printf(", CV %u..%u ms ahead", lead_min, lead_max);
+    printf("\n");
+
+    unsigned presses = 0, missed = 0;
+    for (size_t i = 0; i < n_events; i++) {
+        event_t *e = &events[i];
+        if (e->kind != EV_PRESS || e->t > now_ms) continue;
+        presses++;
+        if (e->seen) continue;
+        missed++;
+        if (verbose || missed <= 5)
+            printf("           missed %c %u ms press at %u ms%s\n", btn_names[e->btn], e->hold, e->t,
+                   e->line ? "" : " (jam)");
+    }
+    printf("Presses:   %u, %u missed\n", presses, missed);
+
+    printf("Boot:      first step at %u ms, main loop from %.1f ms (%u EEPROM writes before it)\n",
+           first_step_ms, loop_first_us / 1000.0, ee_boot_writes);
+
+    printf("Main loop: %llu passes, longest button sample gap %.1f ms (at %u ms)\n",
+           (unsigned long long)loop_passes, gap_max_us / 1000.0, gap_max_at);
+
+    uint32_t busiest = 0;
+    for (int i = 1; i < EE_SIZE; i++)
+        if (ee_cell_writes[i] > ee_cell_writes[busiest]) busiest = i;
+    printf("EEPROM:    %u byte writes", ee_writes);
+    if (ee_writes) {
+        uint32_t run = ee_cell_writes[busiest];
+        printf(", busiest cell 0x%02X: %u", busiest, run);
+        if (hours > 0 && run > 1)
+            printf(" (%.0f h of this use to %.0fk cycles)", EE_ENDURANCE * hours / run,
+                   EE_ENDURANCE / 1000);
+    }
+    printf("\n");
+
+#ifdef MIDI
+    printf("MIDI out:  %u bytes (%u framing errors, %u dropped), %u notes, %u clocks",
+           midi_bytes, midi_framing, midi_dropped, midi_notes, midi_clocks);
+    if (midi_int_max)
+        printf(", interval %.2f..%.2f ms, worst %.2f ms off the 24 PPQN grid",
+               midi_int_min / 1000.0, midi_int_max / 1000.0, midi_clk_worst / 1000.0);
+    if (midi_clk_skipped) printf(" (%u during tempo edits not checked)", midi_clk_skipped);
+    printf("\n");
+#endif
+
+    printf("Final:     mode %s, bank %u, bpm %u, pattern 0x%08X%s\n", mode_names[current_mode],
+           current_bank, current_bpm, pattern, pattern_dirty ? " (unsaved)" : "");
+    if (expect_fail) printf("%u expect(s) failed\n", expect_fail);
+
+#ifdef MIDI
+    return missed + expect_fail + midi_framing + midi_dropped;
+#else
+    return missed + expect_fail;
+#endif
+}
+
+int main(int argc, char **argv)
+{
+    const char *script = NULL, *ee_path = NULL;
+    uint32_t jam = 0, until = 0;
+
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        if (a[0] != '-') { script = a; continue; }
+        if (a[1] == 'v') { verbose = 1; continue; }
+        if (i + 1 >= argc) goto usage;
+        const char *v = argv[++i];
+        switch (a[1]) {
+        case 't': until = parse_time(v); break;
+        case 'j': jam = strtoul(v, NULL, 0); break;
+        case 's': rng = strtoul(v, NULL, 0) | 1; break;
+        case 'n': noise_lsb = atoi(v); break;
+        case 'l': loop_us = strtoul(v, NULL, 0); break;
+        case 'e': ee_path = v; break;
+        default: goto usage;
+        }
+    }
+
+    if (script) load_script(script);
+    qsort(events, n_events, sizeof(*events), event_cmp);
+    if (!until) {
+        for (size_t i = 0; i < n_events; i++)
+            if (events[i].t + events[i].hold > until) until = events[i].t + events[i].hold;
+        until = until ? until + 1000 : 60000;
+    }
+    stop_ms = until;
+    if (jam) {
+        add_jam(jam, until);
+        qsort(events, n_events, sizeof(*events), event_cmp);
+    }
+
+    eeprom_load(ee_path);
+    clock_t c0 = clock();
+
+    load_settings();
+    setup();
+    init_eeprom();
+    loop_first_us = now_us;
+    while (now_ms < stop_ms) {
+        uint64_t gap = now_us - loop_start_us;
+        if (loop_passes && gap > gap_max_us) {
+            gap_max_us = gap;
+            gap_max_at = now_ms;
+        }
+        loop_start_us = now_us;
+
+        loop();
+        sim_emph_end();
+        loop_passes++;
+        if (active_press >= 0 && current_btn == events[active_press].btn)
+            events[active_press].seen = 1;
+        if (verbose) log_changes();
+        sim_advance(loop_us);
+    }
+
+    double host_s = (double)(clock() - c0) / CLOCKS_PER_SEC;
+    eeprom_save(ee_path);
+    return report(host_s) ? 1 : 0;
+
+usage:
+    fprintf(stderr, "usage: %s [-t TIME] [-j N] [-s SEED] [-n LSB] [-l US] [-e FILE] [-v] [script]\n",
+            argv[0]);
+    return 2;
+}
@@ -0,0 +1,26 @@
+#ifndef SYNTH_HOST_H
+#define SYNTH_HOST_H
+
+// --- Native Hardware Stand-in for synthesizer/voices.h (HOST_SIM builds) ---
+// The host tool calls TIMER0_COMPA_vect() once per sample and reads the
+// PWM duty from sim_pwm; sim_clips counts samples the mixer clipped.
+// PROGMEM tables are plain arrays.
+
+#include <stdint.h>
+
+#define ISR(vector) void vector(void)
+#define sei() ((void)0)
+#define cli() ((void)0)
+
+#define PROGMEM
+#define pgm_read_byte(p) (*(const uint8_t *)(p))
+
+// --- Registers ---
+#define PB0 0
+extern uint8_t SREG, DDRB, PORTB, PINB;
+extern uint8_t sim_pwm;  // OCR1A
+#define OCR1A sim_pwm
+extern uint32_t sim_clips;
+#define MIXER_CLIP_HOOK() (sim_clips++)
+
+#endif // SYNTH_HOST_H
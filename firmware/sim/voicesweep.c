@@ -0,0 +1,288 @@
+// voicesweep - render every voice over the pot and accent grid, as CSV
+//
+// Builds synthesizer/voices.h natively (HOST_SIM) and renders each grid
+// point from reset: voice x DECAY pot x TONE pot x CV level, with the pots
+// mapped as main.c maps them (set_param_decay(pot), set_param_tone(470 +
+// pot * 6)) and the accent main.c derives from the CV reading. A render
+// runs the mixer ISR until the voice goes idle (or -m MS). The engine's
+// state is file-scope globals, as on the chip, so renders run in forked
+// processes, -j at a time (default: one per core); results come back
+// through shared memory, and every render starts from the same state.
+//
+// Columns per render:
+//   peak        highest PWM duty
+//   clips       samples where the mixer's output > 255 path clipped
+//   t60_ms      end of the last 1 ms block within 60 dB of the loudest
+//               (RMS of the duty; 8-bit output, so roughly "until silent")
+//   centroid_hz spectral centroid of the first 8192 samples (DC removed)
+//   len_ms      render length
+//
+// Usage: voicesweep [-d N] [-t N] [-a N] [-m MS] [-j JOBS] [-o FILE]
+//   -d N      DECAY pot grid points across 0-255 (default 16)
+//   -t N      TONE pot grid points across 0-255 (default 16)
+//   -a N      CV grid points across 11-255 (default 4)
+//   -m MS     longest render (default 3000)
+//   -j JOBS   renders in parallel (default: online CPUs)
+//   -o FILE   CSV output (default stdout)
+//
+// The summary on stderr lists the worst clipping settings.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include "../synthesizer/voices.h"
+#include "../synthesizer/trigger.h"
+
+uint8_t SREG, DDRB, PORTB, PINB;
+uint8_t sim_pwm;
+uint32_t sim_clips;
+
+#define FFT_N 8192
+#define MS_SAMPLES (MIX_RATE / 1000)
+
+enum { C_KICK, C_SNARE, C_HIHAT_CLOSED, C_HIHAT_OPEN, C_CLAP, C_TOM, C_COWBELL, C_COUNT };
+static const char *case_names[C_COUNT] = {
+    "kick", "snare", "hihat-c", "hihat-o", "clap", "tom", "cowbell"
+};
+static const uint8_t case_voice[C_COUNT] = { 0, 1, 2, 2, 3, 4, 5 };
+
+typedef struct {
+    uint8_t c, decay, tone, cv;
+    uint16_t accent;
+} job_t;
+
+typedef struct {
+    uint8_t done;
+    uint8_t peak;
+    uint32_t clips;
+    uint32_t samples;
+    double t60_ms;
+    double centroid_hz;
+} result_t;
+
+static uint32_t max_ms = 3000;
+
+static uint8_t grid_point(int i, int n, int lo, int hi)
+{
+    return (n <= 1) ? hi : lo + (hi - lo) * i / (n - 1);
+}
+
+// FFT_N-point twiddles, filled before the renders fork
+static double tw_re[FFT_N / 2], tw_im[FFT_N / 2];
+
+static void fft_init(void)
+{
+    for (uint32_t k = 0; k < FFT_N / 2; k++) {
+        tw_re[k] = cos(-2 * M_PI * k / FFT_N);
+        tw_im[k] = sin(-2 * M_PI * k / FFT_N);
+    }
+}
+
+// Magnitude spectrum centroid (in-place radix-2 FFT)
+static double centroid(const uint8_t *x, uint32_t len)
+{
+    static double re[FFT_N], im[FFT_N];
+    uint32_t n = 256;
+    while (n < len && n < FFT_N) n <<= 1;
+    if (len > n) len = n;
+
+    double mean = 0;
+    for (uint32_t i = 0; i < len; i++) mean += x[i];
+    mean /= len;
+    for (uint32_t i = 0; i < n; i++) {
+        re[i] = (i < len) ? x[i] - mean : 0;
+        im[i] = 0;
+    }
+    for (uint32_t i = 1, j = 0; i < n; i++) {
+        uint32_t bit = n >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j ^= bit;
+        if (i < j) {
+            double t = re[i]; re[i] = re[j]; re[j] = t;
+        }
+    }
+    for (uint32_t size = 2; size <= n; size <<= 1) {
+        uint32_t stride = FFT_N / size;
+        for (uint32_t k = 0; k < size / 2; k++) {
+            double wr = tw_re[k * stride], wi = tw_im[k * stride];
+            for (uint32_t i = k; i < n; i += size) {
+                uint32_t j = i + size / 2;
+                double tr = re[j] * wr - im[j] * wi, ti = re[j] * wi + im[j] * wr;
+                re[j] = re[i] - tr; im[j] = im[i] - ti;
+                re[i] += tr; im[i] += ti;
+            }
+        }
+    }
+    double sum = 0, weighted = 0;
+    for (uint32_t k = 1; k <= n / 2; k++) {
+        double m = hypot(re[k], im[k]);
+        sum += m;
+        weighted += m * k * MIX_RATE / n;
+    }
+    return sum > 0 ? weighted / sum : 0;
+}
+
+// Runs in a child process, from the engine's reset state
+static void render(const job_t *j, result_t *r)
+{
+    static uint8_t buf[FFT_N];
+    uint32_t max_samples = max_ms * MS_SAMPLES;
+    double block = 0, block_max = 0;
+    uint32_t n_blocks = 0, n_buf = 0;
+    static double levels[60000];  // 1 ms blocks, enough for -m 60000
+
+    set_param_decay(j->decay);
+    set_param_tone(470 + (uint16_t)j->tone * 6);
+    current_voice = case_voice[j->c];
+    if (j->c == C_HIHAT_CLOSED) h_decay_speed = DECAY_LOG(192);
+    if (j->c == C_HIHAT_OPEN) h_decay_speed = DECAY_LOG(128);
+    update_hihat_decay();
+    trigger_current_voice_with_accent(j->accent);
+
+    uint32_t n;
+    for (n = 0; n < max_samples; n++) {
+        TIMER0_COMPA_vect();
+        if (sim_pwm > r->peak) r->peak = sim_pwm;
+        if (n_buf < FFT_N) buf[n_buf++] = sim_pwm;
+        block += (double)sim_pwm * sim_pwm;
+        if ((n + 1) % MS_SAMPLES == 0) {
+            double rms = sqrt(block / MS_SAMPLES);
+            if (n_blocks < sizeof(levels) / sizeof(levels[0])) levels[n_blocks++] = rms;
+            if (rms > block_max) block_max = rms;
+            block = 0;
+        }
+        if (!(voice_active & ~V_ENV)) {
+            n++;
+            break;
+        }
+    }
+    r->samples = n;
+    r->clips = sim_clips;
+
+    r->t60_ms = 0;
+    for (uint32_t b = n_blocks; b-- > 0;) {
+        if (levels[b] > block_max / 1000.0) {
+            r->t60_ms = b + 1;
+            break;
+        }
+    }
+    r->centroid_hz = centroid(buf, n_buf);
+    r->done = 1;
+}
+
+int main(int argc, char **argv)
+{
+    int n_decay = 16, n_tone = 16, n_cv = 4;
+    long jobs_max = sysconf(_SC_NPROCESSORS_ONLN);
+    const char *out_path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        if (a[0] != '-' || i + 1 >= argc) goto usage;
+        const char *v = argv[++i];
+        switch (a[1]) {
+        case 'd': n_decay = atoi(v); break;
+        case 't': n_tone = atoi(v); break;
+        case 'a': n_cv = atoi(v); break;
+        case 'm': max_ms = strtoul(v, NULL, 0); break;
+        case 'j': jobs_max = atol(v); break;
+        case 'o': out_path = v; break;
+        default: goto usage;
+        }
+    }
+    if (n_decay < 1 || n_tone < 1 || n_cv < 1 || max_ms < 1 || max_ms > 60000) goto usage;
+    if (jobs_max < 1) jobs_max = 1;
+
+    size_t n_jobs = (size_t)C_COUNT * n_decay * n_tone * n_cv;
+    job_t *jobs = malloc(n_jobs * sizeof(*jobs));
+    result_t *results = mmap(NULL, n_jobs * sizeof(*results), PROT_READ | PROT_WRITE,
+                             MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (!jobs || results == MAP_FAILED) { perror("voicesweep"); return 2; }
+
+    size_t k = 0;
+    for (int c = 0; c < C_COUNT; c++)
+        for (int d = 0; d < n_decay; d++)
+            for (int t = 0; t < n_tone; t++)
+                for (int a = 0; a < n_cv; a++) {
+                    job_t *j = &jobs[k++];
+                    j->c = c;
+                    j->decay = grid_point(d, n_decay, 0, 255);
+                    j->tone = grid_point(t, n_tone, 0, 255);
+                    j->cv = grid_point(a, n_cv, CV_THRESHOLD_ON + 1, 255);
+                    j->accent = 16384 + (uint16_t)(j->cv - CV_THRESHOLD_ON) * 200;
+                }
+
+    // One child per render, jobs_max in flight
+    fft_init();
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    long running = 0;
+    for (size_t i = 0; i < n_jobs; i++) {
+        if (running == jobs_max) {
+            wait(NULL);
+            running--;
+        }
+        pid_t pid = fork();
+        if (pid < 0) { perror("fork"); return 2; }
+        if (pid == 0) {
+            render(&jobs[i], &results[i]);
+            _exit(0);
+        }
+        running++;
+    }
+    while (running-- > 0) wait(NULL);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    FILE *out = out_path ? fopen(out_path, "w") : stdout;
+    if (!out) { perror(out_path); return 2; }
+    fprintf(out, "voice,decay,tone,cv,accent,peak,clips,t60_ms,centroid_hz,len_ms\n");
+    size_t clipping = 0, failed = 0, worst[5] = { 0 };
+    int n_worst = 0;
+    for (size_t i = 0; i < n_jobs; i++) {
+        job_t *j = &jobs[i];
+        result_t *r = &results[i];
+        if (!r->done) { failed++; continue; }
+        fprintf(out, "%s,%u,%u,%u,%u,%u,%u,%.0f,%.0f,%.1f\n", case_names[j->c], j->decay,
+                j->tone, j->cv, j->accent, r->peak, r->clips, r->t60_ms, r->centroid_hz,
+                r->samples * 1000.0 / MIX_RATE);
+        if (!r->clips) continue;
+        clipping++;
+        // Keep the five worst, most clips first
+        int p = n_worst;
+        if (p == 5) {
+            if (results[worst[4]].clips >= r->clips) continue;
+            p = 4;
+        } else {
+            n_worst++;
+        }
+        while (p > 0 && results[worst[p - 1]].clips < r->clips) {
+            worst[p] = worst[p - 1];
+            p--;
+        }
+        worst[p] = i;
+    }
+    if (out != stdout) fclose(out);
+
+    double secs = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+    fprintf(stderr, "SAMPLE_RATE %d (actual %d Hz): %zu renders in %.2f s (%ld jobs)\n",
+            SAMPLE_RATE, MIX_RATE, n_jobs, secs, jobs_max);
+    fprintf(stderr, "%zu clip", clipping);
+    for (int w = 0; w < n_worst; w++) {
+        job_t *j = &jobs[worst[w]];
+        fprintf(stderr, "%s %s decay %u tone %u cv %u: %u samples", w ? "," : ":",
+                case_names[j->c], j->decay, j->tone, j->cv, results[worst[w]].clips);
+    }
+    fprintf(stderr, "\n");
+    if (failed) fprintf(stderr, "%zu renders failed\n", failed);
+    return failed ? 2 : 0;
+
+usage:
+    fprintf(stderr, "usage: %s [-d N] [-t N] [-a N] [-m MS] [-j JOBS] [-o FILE]\n", argv[0]);
+    return 2;
+}
@@ -4,7 +4,10 @@
 #include <avr/io.h>
 #include <avr/interrupt.h>
 #include <util/delay.h>
+#include "../common/clock.h"
 #include "../common/adc.h"
+#include "../common/instrument.h"
+#include "voice_params.h"
 
 // --- Pin Configuration ---
 #define SPEAKER_PIN PB1  // PWM output (OC1A)
@@ -12,23 +15,25 @@
 #define DECAY_CH 1       // PB2 = ADC1
 #define TONE_CH 3        // PB3 = ADC3
 
+_Static_assert(F_CPU / MIXER_PRESCALER == MIXER_TIMER_HZ, "MIXER_TIMER_HZ does not match F_CPU");
+
 // --- Hardware Setup ---
 static inline void setup_hardware(void)
 {
-    // 1. Timer1 for PWM (64MHz PLL -> 250kHz PWM)
+    // 1. Timer1 for PWM (64MHz PLL -> 250kHz PWM, same on both clock profiles;
+    //    with CLOCK=16 the PLL is already running as the system clock). The
+    //    PLL locks while the rest starts up; until step 5 Timer1 runs from
+    //    the system clock, a faster-than-audio carrier all the same.
     PLLCSR |= (1 << PLLE);
-    _delay_ms(1);
-    while (!(PLLCSR & (1 << PLOCK)));
-    PLLCSR |= (1 << PCKE);
-
     TCCR1 = (1 << PWM1A) | (1 << COM1A1) | (1 << CS10);
     GTCCR = 0;
 
-    // 2. Timer0 for sampling (20kHz interrupt)
+    // 2. Timer0 for sampling (SAMPLE_RATE interrupt, prescaler 8)
     TCCR0A = (1 << WGM01);
     TCCR0B = (1 << CS01);
-    OCR0A = 49;
+    OCR0A = MIXER_OCR;
     TIMSK |= (1 << OCIE0A);
+    instr_init(MIXER_PRESCALER);
 
     // 3. ADC initialization
     adc_init();
@@ -37,6 +42,14 @@ static inline void setup_hardware(void)
     DDRB |= (1 << SPEAKER_PIN);
 
     sei();
+
+    // 5. Timer1 onto the PLL with the sample ISR already running: 100us to
+    //    settle, then wait for lock (the datasheet's procedure)
+#if F_CPU == 8000000UL
+    _delay_us(100);
+#endif
+    while (!(PLLCSR & (1 << PLOCK)));
+    PLLCSR |= (1 << PCKE);
 }
 
 #endif // HARDWARE_H
@@ -1,9 +1,22 @@
 #include "hardware.h"
 #include "voices.h"
+#include "trigger.h"
 
-// --- CV Threshold (with hysteresis) ---
-#define CV_THRESHOLD_ON  10  // ~0.2V to trigger
-#define CV_THRESHOLD_OFF 3   // ~0.06V to reset
+// --- Accent Window (make ACCENT_WINDOW=n, 0 = off) ---
+// The RC-filtered CV is still rising when it first crosses the threshold.
+// The voice starts at once at the level of that reading; the next
+// ACCENT_WINDOW CV reads (~110us apart) track the peak, and the voice's
+// volume is then scaled up to it, well inside its first cycle.
+#ifndef ACCENT_WINDOW
+#define ACCENT_WINDOW 8
+#endif
+
+// Accent: CV voltage scales volume (min 25%, max 100%)
+// CV 10-255 maps to 16384-65384
+static inline uint16_t cv_accent(uint8_t cv)
+{
+    return 16384 + ((uint16_t)(cv - CV_THRESHOLD_ON) * 200);
+}
 
 // --- Setup ---
 static void setup(void)
@@ -17,7 +30,9 @@ int main(void)
 {
     setup();
 
-    uint8_t prev_state = 0;
+    uint8_t window = 0;             // CV reads left in the accent window
+    uint8_t cv_first = 0, cv_peak = 0;
+    uint8_t window_voice = 0;
 
     uint8_t loop_div = 0;  // Divide pot reading frequency
 
@@ -26,28 +41,22 @@ int main(void)
         // Read CV first (high priority)
         uint8_t cv = read_adc(CV_INPUT_CH);
 
-        // State with hysteresis
-        uint8_t curr_state;
-        if (cv > CV_THRESHOLD_ON) {
-            curr_state = 1;
-        } else if (cv < CV_THRESHOLD_OFF) {
-            curr_state = 0;
-        } else {
-            curr_state = prev_state;
-        }
-
-        // Rising edge (LOW -> HIGH) = trigger current voice with accent
-        if (curr_state && !prev_state) {
-            // Accent: CV voltage scales volume (min 25%, max 100%)
-            // CV 10-255 maps to 16384-65384
-            uint16_t accent_vol = 16384 + ((uint16_t)(cv - CV_THRESHOLD_ON) * 200);
+        // Threshold crossing or retrigger = trigger current voice with accent
+        if (cv_detect(cv)) {
             cli();
-            trigger_current_voice_with_accent(accent_vol);
+            trigger_current_voice_with_accent(cv_accent(cv));
             sei();
+            cv_first = cv_peak = cv;
+            window = ACCENT_WINDOW;
+            window_voice = current_voice;
+        } else if (window) {
+            // Accent window: follow the CV up, then correct the volume
+            if (cv > cv_peak)
+                cv_peak = cv;
+            if (--window == 0 && cv_peak > cv_first && current_voice == window_voice)
+                rescale_current_voice(cv_accent(cv_first), cv_accent(cv_peak));
         }
 
-        prev_state = curr_state;
-
         // Check voice button frequently (every 16 loops)
         if ((loop_div & 0x0F) == 0) {
             update_voice_button();
@@ -60,21 +69,13 @@ int main(void)
             uint8_t decay_raw = read_adc(DECAY_CH);
             uint8_t tone_raw = read_adc(TONE_CH);
 
-            // Map decay to valid values (3, 7, 15)
-            if (decay_raw < 85) param_decay = 3;
-            else if (decay_raw < 170) param_decay = 7;
-            else param_decay = 15;
-
-            // Map param_decay to per-voice decay
-            cb_decay = (param_decay >> 1) | 1;
-            h_decay = (param_decay >> 1) | 1;
-            c_decay = (param_decay >> 1) | 1;
-            t_decay = param_decay >> 1;
-            s_decay = param_decay >> 1;
-            k_decay = param_decay;
+            // Decay: continuous over the pot's travel (per-voice rates)
+            set_param_decay(decay_raw);
 
             // Map tone to frequency range
-            param_tone = 470 + ((uint16_t)tone_raw * 6);
+            set_param_tone(470 + ((uint16_t)tone_raw * 6));
+
+            instr_poll();
         }
     }
 }
@@ -15,19 +15,17 @@ void update_params()
     uint8_t tone_raw = read_adc(TONE_CH);
 
     // Convert to parameter ranges
-    // Decay: must be 2^n-1, max 7 to avoid artifacts
-    uint8_t decay_idx = decay_raw >> 6;  // 0-3
-    if (decay_idx > 2) decay_idx = 2;    // cap at 2
-    param_decay = (1 << (decay_idx + 1)) - 1;  // 1, 3, 7
+    // Decay: continuous, as in main.c
+    set_param_decay(decay_raw);
 
     // Tone: 700-1700 (narrower range to avoid artifacts)
-    param_tone = 700 + ((uint16_t)tone_raw << 2);
+    set_param_tone(700 + ((uint16_t)tone_raw << 2));
 }
 
 // --- Wait with continuous pot/button reading ---
 void wait_and_update(uint16_t ms)
 {
-    uint16_t target_ticks = ms * 20;
+    uint16_t target_ticks = ms_to_ticks(ms);
     tick_counter = 0;
     while (tick_counter < target_ticks) {
         update_params();
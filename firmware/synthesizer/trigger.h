@@ -0,0 +1,68 @@
+#ifndef TRIGGER_H
+#define TRIGGER_H
+
+#include <stdint.h>
+
+// --- CV Threshold (with hysteresis) ---
+#define CV_THRESHOLD_ON  10  // ~0.2V to trigger
+#define CV_THRESHOLD_OFF 3   // ~0.06V to reset
+
+// --- Retrigger (make RETRIGGER=0 for the threshold alone) ---
+// The RC-filtered CV takes ~4.4 time constants to fall from full scale
+// under CV_THRESHOLD_OFF, and a trigger that arrives before then is lost.
+// With RETRIGGER the detector follows the CV after a trigger instead: a
+// fall of a quarter of the peak (plus a margin over the PWM ripple) arms
+// it, and a rise from the lowest reading since then triggers again. A
+// fall all the way under CV_THRESHOLD_OFF still resets it as before.
+#ifndef RETRIGGER
+#define RETRIGGER 1
+#endif
+
+#define CV_DROP_MARGIN 8     // ADC counts on top of peak/4
+#define CV_IDLE 0            // Waiting for CV_THRESHOLD_ON
+#define CV_HIGH 1            // Triggered: cv_level is the peak
+#define CV_DIP  2            // Falling: cv_level is the trough
+
+uint8_t cv_state = CV_IDLE;
+uint8_t cv_level = 0;        // Peak (CV_HIGH) or trough (CV_DIP)
+uint8_t cv_rise = 0;         // Rise from the trough that retriggers
+
+// One CV reading; returns 1 on a trigger
+static inline uint8_t cv_detect(uint8_t cv)
+{
+    if (cv < CV_THRESHOLD_OFF) {
+        cv_state = CV_IDLE;
+        return 0;
+    }
+    if (cv_state == CV_IDLE) {
+        if (cv <= CV_THRESHOLD_ON)
+            return 0;
+        cv_state = CV_HIGH;
+        cv_level = cv;
+        return 1;
+    }
+#if RETRIGGER
+    if (cv_state == CV_HIGH) {
+        uint8_t drop = (cv_level >> 2) + CV_DROP_MARGIN;
+        if (cv > cv_level) {
+            cv_level = cv;
+        } else if (cv_level - cv > drop) {
+            cv_state = CV_DIP;
+            cv_level = cv;
+            cv_rise = drop >> 1;
+        }
+        return 0;
+    }
+    // CV_DIP
+    if (cv < cv_level) {
+        cv_level = cv;
+    } else if (cv > CV_THRESHOLD_ON && cv - cv_level >= cv_rise) {
+        cv_state = CV_HIGH;
+        cv_level = cv;
+        return 1;
+    }
+#endif
+    return 0;
+}
+
+#endif // TRIGGER_H
@@ -0,0 +1,220 @@
+#ifndef VOICE_PARAMS_H
+#define VOICE_PARAMS_H
+
+// Tuning constants shared by voices.h and mixer.S (#defines only, no C code)
+
+// === SAMPLE RATE (build with `make SAMPLE_RATE=...`) ===
+// Voices were tuned at REF_RATE. Everything that counts samples or adds a
+// phase increment per sample is rescaled below, so any rate sounds the same.
+#ifndef SAMPLE_RATE
+#define SAMPLE_RATE 20000
+#endif
+#define REF_RATE 20000
+
+// Long arithmetic in C (16-bit int), plain numbers for the assembler
+#ifdef __ASSEMBLER__
+#define VP_LONG(x) x
+#else
+#define VP_LONG(x) x##L
+#endif
+
+// Timer0 clock (prescaler 8) as a literal: F_CPU's UL suffix breaks mixer.S
+#define MIXER_PRESCALER 8
+#if F_CPU == 8000000UL
+#define MIXER_TIMER_HZ 1000000
+#elif F_CPU == 16000000UL
+#define MIXER_TIMER_HZ 2000000
+#else
+#error "voice_params.h: no MIXER_TIMER_HZ for this F_CPU"
+#endif
+
+#define MIXER_OCR ((MIXER_TIMER_HZ + SAMPLE_RATE / 2) / SAMPLE_RATE - 1)
+#define MIX_RATE (MIXER_TIMER_HZ / (MIXER_OCR + 1))  // Actual rate (Hz)
+
+#if MIXER_OCR > 255
+#error "SAMPLE_RATE too low for Timer0"
+#endif
+#if MIX_RATE * 100 < SAMPLE_RATE * 99 || MIX_RATE * 100 > SAMPLE_RATE * 101
+#error "SAMPLE_RATE not reachable within 1% (constants follow MIX_RATE anyway)"
+#endif
+
+// Phase increment tuned at REF_RATE -> same frequency at MIX_RATE
+#define RATE_INC(x) ((VP_LONG(x) * REF_RATE + MIX_RATE / 2) / MIX_RATE)
+// Sample count tuned at REF_RATE -> same duration at MIX_RATE
+#define RATE_SAMPLES(x) ((VP_LONG(x) * MIX_RATE + REF_RATE / 2) / REF_RATE)
+
+// Envelope clock: decays and pitch sweeps run on "env ticks". Below
+// REF_RATE ticks come at half the rate (ENV_SHIFT) and decay rates double
+// (DECAY_LOG); when that leaves a non-integer tick rate, an 8-bit
+// accumulator adds ENV_INC per sample and each carry is one tick (flagged
+// in voice_active bit VB_ENV).
+#if MIX_RATE >= REF_RATE
+#define ENV_SHIFT 0
+#elif MIX_RATE * 2 >= REF_RATE
+#define ENV_SHIFT 1
+#else
+#error "SAMPLE_RATE below REF_RATE / 2 is not supported"
+#endif
+#define ENV_INC ((VP_LONG(256) * REF_RATE + (MIX_RATE << ENV_SHIFT) / 2) / (MIX_RATE << ENV_SHIFT))
+#if ENV_INC < 256
+#define ENV_FRACTIONAL
+#endif
+
+// Control rate: each env tick runs the control update (decay, pitch sweep)
+// of one slot, so every slot comes round once per CTRL_SLOTS env ticks
+// (2.5kHz at REF_RATE). Slots 0-5 are the voice envelopes (VB_* order);
+// 6 and 7 both run the kick and tom pitch sweeps, each covering half a
+// control tick (CTRL_SWEEP_TICKS), which halves how far the stepped pitch
+// runs ahead of a per-tick sweep.
+#define CTRL_SHIFT 3
+#define CTRL_SLOTS (1 << CTRL_SHIFT)
+#define CTRL_SWEEP_A 6
+#define CTRL_SWEEP_B 7
+#define CTRL_SWEEP_SHIFT (CTRL_SHIFT - 1)
+#define CTRL_SWEEP_TICKS (1 << CTRL_SWEEP_SHIFT)
+
+// Kick sweep: k_step -= k_step >> K_SWEEP_SHIFT per env tick, applied as
+// CTRL_SWEEP_TICKS of those per sweep slot (proportional, so the phase
+// increment scale does not matter)
+#define K_SWEEP_SHIFT (7 - ENV_SHIFT)
+
+// param_tone (pot) is a phase increment at REF_RATE, rescaled in Q12
+#define TONE_SCALE_Q12 RATE_INC(4096)
+
+// Tom sweep: t_step drops 1 per sample at REF_RATE. Per env tick that is
+// (REF_RATE / MIX_RATE)^2 * 256 / ENV_INC in rescaled units; per sweep
+// slot CTRL_SWEEP_TICKS times that, kept as 8.8
+#define T_SWEEP_Q8 (((TONE_SCALE_Q12 * TONE_SCALE_Q12 / ENV_INC) * CTRL_SWEEP_TICKS + 128) >> 8)
+#define T_SWEEP_DEC (T_SWEEP_Q8 >> 8)
+#define T_SWEEP_FRAC (T_SWEEP_Q8 & 0xFF)
+#if T_SWEEP_DEC > 63
+#error "Tom sweep step too large for mixer.S (sbiw)"
+#endif
+
+// Decay rate: decay steps per control tick on a log scale, 32 per octave,
+// 128 = one step per control tick at REF_RATE (2.5k steps/s). Each voice
+// keeps it as x_decay (8-bit fraction, added to x_decay_acc; a carry is a
+// step) and x_decay_log2 (that step is 2^x_decay_log2 single steps).
+#define DECAY_LOG_OCTAVE 32
+#define DECAY_LOG(x) ((x) + DECAY_LOG_OCTAVE * ENV_SHIFT)  // Rate at REF_RATE -> env ticks
+#define DECAY_LOG_MAX 223   // x_decay_log2 <= 3 (mixer.S), ~8 steps per control tick
+
+// === TUNING CONSTANTS ===
+// Initial volumes (0-65535)
+#define K_VOL_INIT      65535   // Kick: max
+#define S_VOL_INIT      25000   // Snare noise (was 35000, reduce crash)
+#define S_TONE_VOL_INIT 50000   // Snare tone body
+#define H_VOL_INIT      20000   // Hihat (was 30000, more subtle)
+#define C_VOL_INIT      50000   // Clap
+#define T_VOL_INIT      55000   // Tom
+#define CB_VOL_INIT     45000   // Cowbell
+
+// Decay rate shifts per env tick (higher = slower decay, mixer.S supports
+// 7 and 8). A control tick may apply several steps: see decay_step()
+#define K_DECAY_SHIFT   7       // Kick (was 8, faster now)
+#define S_NOISE_SHIFT   8       // Snare noise
+#define S_TONE_SHIFT    7       // Snare tone (was 6, slower = less crash)
+#define H_DECAY_SHIFT   7       // Hihat
+#define C_DECAY_SHIFT   8       // Clap
+#define T_DECAY_SHIFT   7       // Tom
+#define CB_DECAY_SHIFT  7       // Cowbell
+
+// Metal oscillator bank (metal_step() in voices.h): eight square waves,
+// one per bit ("lane"), each flipping every P samples. Lanes 0-5 are the
+// hi-hat's six detuned oscillators, 6 and 7 the COWBELL=metal pair (P from
+// set_param_tone). Periods are picked to stay distinct at every rate.
+#define H_METAL_P0      RATE_SAMPLES(23)  // ~435 Hz
+#define H_METAL_P1      RATE_SAMPLES(17)  // ~590 Hz
+#define H_METAL_P2      RATE_SAMPLES(13)  // ~770 Hz
+#define H_METAL_P3      RATE_SAMPLES(11)  // ~910 Hz
+#define H_METAL_P4      RATE_SAMPLES(8)   // ~1250 Hz
+#define H_METAL_P5      RATE_SAMPLES(6)   // ~1670 Hz
+#define H_METAL_LEVEL   20      // Per ring-modulated lane pair (0-60)
+#define CB_METAL_LEVEL  96      // Per cowbell lane (0-192)
+#define METAL_HIHAT     0x3F    // Lane masks
+#define METAL_COWBELL   0xC0
+
+// Counter planes: half periods up to 1 << METAL_BITS samples
+#if MIX_RATE <= REF_RATE
+#define METAL_BITS 5
+#else
+#define METAL_BITS 6
+#endif
+#if H_METAL_P0 > (1 << METAL_BITS)
+#error "H_METAL_P0 does not fit METAL_BITS"
+#endif
+
+// Cycle allowance of mixer.S's ISR, all six voices: tools/wcet.py's bound
+// today (make -C ../sim mixwcet). It is above the sample period by design
+// (see mixer.S); the build's WCET check fails when the mixer grows past it.
+// The fractional envelope clock adds 12, the sixth counter plane 10 and
+// the noise filter (NOISE_SVF) 212.
+#if defined(SINE_INTERP) && defined(COWBELL_METAL)
+#define MIXER_ASM_WCET_BASE 695
+#elif defined(SINE_INTERP)
+#define MIXER_ASM_WCET_BASE 813
+#elif defined(COWBELL_METAL)
+#define MIXER_ASM_WCET_BASE 608
+#else
+#define MIXER_ASM_WCET_BASE 668
+#endif
+#ifdef ENV_FRACTIONAL
+#define MIXER_ASM_WCET_ENV 12
+#else
+#define MIXER_ASM_WCET_ENV 0
+#endif
+#ifdef NOISE_SVF
+#define MIXER_ASM_WCET_SVF 212
+#else
+#define MIXER_ASM_WCET_SVF 0
+#endif
+#define MIXER_ASM_WCET (MIXER_ASM_WCET_BASE + MIXER_ASM_WCET_ENV + (METAL_BITS - 5) * 10 + \
+                        MIXER_ASM_WCET_SVF)
+
+// Noise filter (make NOISE_SVF=1, see svf_step() in voices.h): the tap
+// each noise voice plays instead of raw LFSR bits
+#define SVF_LP          0
+#define SVF_BP          1
+#define SVF_HP          2
+#define S_SVF_TAP       SVF_BP  // Snare: band around the cutoff
+#define H_SVF_TAP       SVF_HP  // Hi-hat: above it
+#define C_SVF_TAP       SVF_BP  // Clap
+
+// Clap stutter: each burst is C_BURST_ON samples on, then silent until C_BURST_LEN
+#define C_BURST_ON      RATE_SAMPLES(60)   // 3 ms
+#define C_BURST_LEN     RATE_SAMPLES(200)  // 10 ms
+
+// Cowbell base pitch (added to param_tone / 2)
+#define CB_BASE_STEP    RATE_INC(1500)
+
+// Tom start pitch above param_tone
+#define T_STEP_OFFSET   RATE_INC(200)
+
+// --- Active voice mask (voice_active) ---
+#define VB_KICK    0
+#define VB_SNARE   1
+#define VB_HIHAT   2
+#define VB_CLAP    3
+#define VB_TOM     4
+#define VB_COWBELL 5
+#define VB_ENV     7  // Not a voice: env tick this sample (ENV_FRACTIONAL)
+
+#define V_KICK    (1 << VB_KICK)
+#define V_SNARE   (1 << VB_SNARE)
+#define V_HIHAT   (1 << VB_HIHAT)
+#define V_CLAP    (1 << VB_CLAP)
+#define V_TOM     (1 << VB_TOM)
+#define V_COWBELL (1 << VB_COWBELL)
+#define V_ENV     (1 << VB_ENV)
+
+// Voices that clock the metal bank
+#ifdef COWBELL_METAL
+#define METAL_VOICES (V_HIHAT | V_COWBELL)
+#else
+#define METAL_VOICES V_HIHAT
+#endif
+
+// Voices that read the noise filter
+#define NOISE_VOICES (V_SNARE | V_HIHAT | V_CLAP)
+
+#endif // VOICE_PARAMS_H
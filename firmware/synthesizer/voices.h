@@ -1,46 +1,85 @@
 #ifndef VOICES_H
 #define VOICES_H
 
+#ifdef HOST_SIM
+#include "../sim/synth_host.h"
+#else
 #include <avr/io.h>
 #include <avr/interrupt.h>
 #include <avr/pgmspace.h>
+#endif
+#include "../common/instrument.h"
+#include "voice_params.h"
+
+#if defined(MIXER_ASM) && defined(INSTRUMENT)
+#error "INSTRUMENT hooks live in the C mixer; build with MIXER=c"
+#endif
+
+// Clip counter for host tools (sim/synth_host.h); nothing on the chip
+#ifndef MIXER_CLIP_HOOK
+#define MIXER_CLIP_HOOK() ((void)0)
+#endif
 
 // --- Sine Wave Table (PROGMEM) ---
-const uint8_t sinewave[] PROGMEM = {
-    128, 134, 140, 147, 153, 159, 165, 171, 177, 182, 188, 193, 198, 203, 208, 212,
-    216, 220, 224, 227, 231, 234, 236, 239, 241, 243, 245, 247, 248, 249, 250, 250,
-    250, 250, 249, 248, 247, 245, 243, 241, 239, 236, 234, 231, 227, 224, 220, 216,
-    212, 208, 203, 198, 193, 188, 182, 177, 171, 165, 159, 153, 147, 140, 134, 128,
-    122, 116, 109, 103, 97, 91, 85, 79, 74, 68, 63, 58, 53, 48, 44, 40,
-    36, 32, 29, 25, 22, 19, 17, 15, 13, 11, 9, 8, 7, 6, 6, 6,
-    6, 7, 8, 9, 11, 13, 15, 17, 19, 22, 25, 29, 32, 36, 40, 44,
-    48, 53, 58, 63, 68, 74, 79, 85, 91, 97, 103, 109, 116, 122};
+// Quarter wave, 128 + 122 * sin(i/64 * 90deg) for i = 0..64. sine_lookup()
+// folds it into a full 256-step cycle; entry 64 (the peak) is what the
+// falling quadrants reach at their start, and the last interpolation point.
+const uint8_t sine_quarter[65] PROGMEM = {
+    128, 131, 134, 137, 140, 143, 146, 149, 152, 155, 158, 161, 163, 166, 169, 172,
+    175, 177, 180, 183, 186, 188, 191, 193, 196, 198, 201, 203, 205, 208, 210, 212,
+    214, 216, 218, 220, 222, 224, 226, 228, 229, 231, 233, 234, 236, 237, 238, 240,
+    241, 242, 243, 244, 245, 246, 246, 247, 248, 248, 249, 249, 249, 250, 250, 250,
+    250};
+
+// Sine (6-250, centered on 128) at a 16-bit phase. Bits 15-14 pick the
+// quadrant, bits 13-8 the entry; with SINE_INTERP the low byte interpolates
+// toward the next entry (adjacent entries differ by at most 3).
+// mixer.S SINE macro must stay bit-exact with this.
+static inline uint8_t sine_lookup(uint16_t phase)
+{
+    uint16_t pos = phase;
+    if (phase & 0x4000)
+        pos = -phase;  // Falling quadrant: mirror, 0x4000 lands on the peak
+    pos &= 0x7FFF;
+
+    uint8_t s = pgm_read_byte(&sine_quarter[pos >> 8]);
+#ifdef SINE_INTERP
+    uint8_t frac = pos;
+    if (frac)
+    {
+        uint8_t d = pgm_read_byte(&sine_quarter[(pos >> 8) + 1]) - s;
+        s += ((uint16_t)d * frac) >> 8;
+    }
+#endif
+    return (phase & 0x8000) ? (uint8_t)(256 - s) : s;
+}
 
 // --- Global Variables (for Mixer) ---
 volatile uint16_t tick_counter = 0;
 
 // --- Configurable Parameters (set via ADC) ---
-volatile uint8_t param_decay = 7;      // Decay speed (must be 2^n-1: 1,3,7,15)
-volatile uint16_t param_tone = 1000;   // Initial pitch for kick
-
-// === TUNING CONSTANTS ===
-// Initial volumes (0-65535)
-#define K_VOL_INIT      65535   // Kick: max
-#define S_VOL_INIT      25000   // Snare noise (was 35000, reduce crash)
-#define S_TONE_VOL_INIT 50000   // Snare tone body
-#define H_VOL_INIT      20000   // Hihat (was 30000, more subtle)
-#define C_VOL_INIT      50000   // Clap
-#define T_VOL_INIT      55000   // Tom
-#define CB_VOL_INIT     45000   // Cowbell
-
-// Decay rate shifts (higher = slower decay)
-#define K_DECAY_SHIFT   7       // Kick (was 8, faster now)
-#define S_NOISE_SHIFT   8       // Snare noise
-#define S_TONE_SHIFT    7       // Snare tone (was 6, slower = less crash)
-#define H_DECAY_SHIFT   7       // Hihat
-#define C_DECAY_SHIFT   8       // Clap
-#define T_DECAY_SHIFT   7       // Tom
-#define CB_DECAY_SHIFT  7       // Cowbell
+volatile uint8_t param_decay = 127;    // DECAY pot (0-255, set via set_param_decay)
+volatile uint16_t param_tone = RATE_INC(1000);  // Kick start pitch (set via set_param_tone)
+volatile uint16_t k_tone_end = RATE_INC(1000) / 20;  // Kick sweep end (param_tone / 20)
+volatile uint16_t t_tone_end = RATE_INC(1000) / 10;  // Tom sweep end (param_tone / 10)
+
+// --- Mixer State in Reserved Registers (MIXER=asm) ---
+// mixer.S keeps its hottest state in r2-r15, which the Makefile takes away
+// from the compiler with -ffixed-rN. The C side sees the shared values as
+// global register variables:
+//   r2 SREG save | r3 voice_active | r4:r5 lfsr | r6:r7 mix accumulator
+//   r8:r9 r0/r1 save | r10:r11 k_phase | r12-r15 scratch
+// Nothing linked in may touch r2-r15 from code the ISR can interrupt;
+// check avr-objdump after pulling in new libgcc/libc routines.
+#ifdef MIXER_ASM
+register uint8_t voice_active asm("r3");   // V_* bits
+register uint16_t lfsr asm("r4");          // Noise generator (set up by mixer.S)
+register uint16_t k_phase asm("r10");
+#else
+volatile uint8_t voice_active = 0;         // V_* bits
+volatile uint16_t lfsr = 0xACE1;           // Noise generator (shared by Snare/Hat/Clap)
+volatile uint16_t k_phase = 0;
+#endif
 
 // --- Voice Selection Button ---
 #define VOICE_BTN_PIN PB0
@@ -48,36 +87,60 @@ volatile uint16_t param_tone = 1000;   // Initial pitch for kick
 volatile uint8_t current_voice = 0;    // 0=kick, 1=snare, 2=hihat, 3=clap, 4=tom, 5=cowbell
 volatile uint8_t btn_prev_state = 1;   // Previous button state (1=released)
 
-// Per-voice decay masks (set from param_decay in main loop)
-volatile uint8_t k_decay = 7;      // Kick: longer
-volatile uint8_t s_decay = 7;      // Snare
-volatile uint8_t h_decay = 3;      // Hi-Hat: shorter
-volatile uint8_t c_decay = 3;      // Clap: shorter
-volatile uint8_t t_decay = 7;      // Tom
-volatile uint8_t cb_decay = 3;     // Cowbell: shorter
+// Per-voice decay rates (set from the DECAY pot by set_param_decay, see
+// DECAY_LOG in voice_params.h). Defaults: 1 step per control tick for the
+// kick, 2 for the others.
+volatile uint8_t k_decay = 128;                     // Kick: longer
+volatile uint8_t k_decay_log2 = 1 + ENV_SHIFT;
+volatile uint8_t s_decay = 128;                     // Snare
+volatile uint8_t s_decay_log2 = 2 + ENV_SHIFT;
+volatile uint8_t h_decay = 128;                     // Hi-Hat: shorter
+volatile uint8_t h_decay_log2 = 2 + ENV_SHIFT;
+volatile uint8_t c_decay = 128;                     // Clap: shorter
+volatile uint8_t c_decay_log2 = 2 + ENV_SHIFT;
+volatile uint8_t t_decay = 128;                     // Tom
+volatile uint8_t t_decay_log2 = 2 + ENV_SHIFT;
+volatile uint8_t cb_decay = 128;                    // Cowbell: shorter
+volatile uint8_t cb_decay_log2 = 2 + ENV_SHIFT;
+
+// Envelope clock (see voice_params.h): every sample at 10 and 20kHz,
+// otherwise each carry of env_acc is one tick
+#ifdef ENV_FRACTIONAL
+volatile uint8_t env_acc = 0;
+#define ENV_TICK() (voice_active & V_ENV)
+#else
+#define ENV_TICK() 1
+#endif
+
+// Control slot run on the last env tick (0 to CTRL_SLOTS - 1)
+volatile uint8_t ctrl_slot = 0;
+
+// Decay accumulators: x_decay is added on the voice's control tick and
+// each carry is one decay step
+volatile uint8_t k_decay_acc = 0;
+volatile uint8_t s_decay_acc = 0;
+volatile uint8_t h_decay_acc = 0;
+volatile uint8_t c_decay_acc = 0;
+volatile uint8_t t_decay_acc = 0;
+volatile uint8_t cb_decay_acc = 0;
 
 // Kick
-volatile uint16_t k_phase = 0;
 volatile uint16_t k_step = 0;
 volatile uint16_t k_vol = 0;
-volatile uint8_t k_active = 0;
+volatile uint8_t k_lpf = 0;         // Previous sample for the output filter
 
 // Snare
 volatile uint16_t s_vol = 0;        // Noise volume
 volatile uint16_t s_tone_vol = 0;   // Tonal body volume
 volatile uint16_t s_phase = 0;
-volatile uint8_t s_active = 0;
 
 // Hi-Hat
 volatile uint16_t h_vol = 0;
-volatile uint8_t h_active = 0;
-volatile uint8_t h_decay_speed = 1; // 1=Short, 3=Long
-volatile uint16_t h_phase1 = 0;     // Metallic tone oscillator 1
-volatile uint16_t h_phase2 = 0;     // Metallic tone oscillator 2
+volatile uint8_t h_decay_speed = DECAY_LOG(192); // Rate cap: closed 192, open 128
+volatile uint8_t h_decay_pot = DECAY_LOG(160);   // DECAY pot rate before the cap
 
 // Clap
 volatile uint16_t c_vol = 0;
-volatile uint8_t c_active = 0;
 volatile uint8_t c_stutter = 0;     // Stutter counter for clap bursts
 volatile uint16_t c_stutter_timer = 0;
 
@@ -85,16 +148,169 @@ volatile uint16_t c_stutter_timer = 0;
 volatile uint16_t t_phase = 0;
 volatile uint16_t t_step = 0;
 volatile uint16_t t_vol = 0;
-volatile uint8_t t_active = 0;
+volatile uint8_t t_sweep_frac = 0;  // Sweep remainder (T_SWEEP_FRAC rates)
 
 // Cowbell (two oscillators)
 volatile uint16_t cb_phase1 = 0;
 volatile uint16_t cb_phase2 = 0;
 volatile uint16_t cb_vol = 0;
-volatile uint8_t cb_active = 0;
 
-// Noise Generator (shared by Snare/Hat/Clap)
-volatile uint16_t lfsr = 0xACE1;
+// Metal oscillator bank (see metal_step). Counters are bit-sliced: plane
+// metal_cnt[k] holds bit k of all eight lanes' counters. metal_rel holds
+// each lane's reload value P - 1 the same way, inverted.
+#define METAL_PERIOD(step) ((VP_LONG(32768) + (step) / 2) / (step))  // Phase step -> P
+#define CB_STEP_DEFAULT (CB_BASE_STEP + RATE_INC(1000) / 2)           // At the default param_tone
+#define METAL_LANE(p, lane, k) ((((p) - 1) >> (k)) & 1 ? 0 : 1 << (lane))
+#define METAL_REL(k) (METAL_LANE(H_METAL_P0, 0, k) | METAL_LANE(H_METAL_P1, 1, k) | \
+                      METAL_LANE(H_METAL_P2, 2, k) | METAL_LANE(H_METAL_P3, 3, k) | \
+                      METAL_LANE(H_METAL_P4, 4, k) | METAL_LANE(H_METAL_P5, 5, k) | \
+                      METAL_LANE(METAL_PERIOD(CB_STEP_DEFAULT), 6, k) | \
+                      METAL_LANE(METAL_PERIOD(CB_STEP_DEFAULT * 3 / 2), 7, k))
+volatile uint8_t metal_cnt[METAL_BITS];
+volatile uint8_t metal_rel[METAL_BITS] = {
+    METAL_REL(0), METAL_REL(1), METAL_REL(2), METAL_REL(3), METAL_REL(4),
+#if METAL_BITS > 5
+    METAL_REL(5),
+#endif
+};
+volatile uint8_t metal_out = 0;     // Square wave levels, one bit per lane
+
+// Noise filter (NOISE_SVF): Chamberlin state-variable filter, Q = 1, run
+// once per sample on the LFSR while a noise voice plays. The frequency
+// coefficient f is 2^-svf_shift (+ 2^-(svf_shift + svf_shift2) when
+// svf_shift2 is set), so each multiply is two short shifts and an add.
+#ifdef NOISE_SVF
+#define SVF_F(a, d) ((a) | (d) << 4)
+// f per param_tone / 128, nearest to 2 sin(pi fc / fs) for a cutoff 5.5x
+// the TONE pitch (800-2450 Hz over the pot), capped at 0.75 where the
+// filter's HP gain runs away. svf_shift <= 5, svf_shift2 <= 2.
+const uint8_t svf_coef[32] PROGMEM = {
+    SVF_F(5, 0), SVF_F(4, 1), SVF_F(3, 2), SVF_F(2, 0), SVF_F(2, 2), SVF_F(2, 1),
+    SVF_F(1, 0), SVF_F(1, 0), SVF_F(1, 2), SVF_F(1, 2), SVF_F(1, 1), SVF_F(1, 1),
+    SVF_F(1, 1), SVF_F(1, 1), SVF_F(1, 1), SVF_F(1, 1), SVF_F(1, 1), SVF_F(1, 1),
+    SVF_F(1, 1), SVF_F(1, 1), SVF_F(1, 1), SVF_F(1, 1), SVF_F(1, 1), SVF_F(1, 1),
+    SVF_F(1, 1), SVF_F(1, 1), SVF_F(1, 1), SVF_F(1, 1), SVF_F(1, 1), SVF_F(1, 1),
+    SVF_F(1, 1), SVF_F(1, 1)};
+volatile uint8_t svf_shift = 1;     // Set by set_param_tone
+volatile uint8_t svf_shift2 = 0;
+volatile int16_t svf_lp = 0;        // States, input scaled to +-4096
+volatile int16_t svf_bp = 0;
+volatile int16_t svf_hp = 0;
+#endif
+
+#ifdef COWBELL_METAL
+// Half period in samples of a square wave with this phase step
+static inline uint8_t metal_period(uint16_t step)
+{
+    uint16_t p = (32768 + step / 2) / step;
+    return p > (1 << METAL_BITS) ? (1 << METAL_BITS) : p;
+}
+#endif
+
+// Update param_tone and the sweep end points derived from it
+// (keeps the 16-bit divisions out of the mixer ISR). tone is a phase
+// increment at REF_RATE and is rescaled to the build's sample rate.
+static inline void set_param_tone(uint16_t tone)
+{
+#if TONE_SCALE_Q12 != 4096
+    tone = ((uint32_t)tone * TONE_SCALE_Q12) >> 12;
+#endif
+    uint16_t k_end = tone / 20;
+    uint16_t t_end = tone / 10;
+#ifdef COWBELL_METAL
+    // Cowbell lanes at the sine cowbell's pitches (integer half periods)
+    uint16_t cb = CB_BASE_STEP + (tone >> 1);
+    uint8_t r6 = metal_period(cb) - 1;
+    uint8_t r7 = metal_period(cb + (cb >> 1)) - 1;
+#endif
+#ifdef NOISE_SVF
+    uint8_t f = pgm_read_byte(&svf_coef[tone >= 32 * 128 ? 31 : tone >> 7]);
+#endif
+    uint8_t sreg = SREG;
+    cli();
+    param_tone = tone;
+    k_tone_end = k_end;
+    t_tone_end = t_end;
+#ifdef NOISE_SVF
+    svf_shift = f & 0x0F;
+    svf_shift2 = f >> 4;
+#endif
+#ifdef COWBELL_METAL
+    for (uint8_t k = 0; k < METAL_BITS; k++) {
+        uint8_t rel = metal_rel[k] & METAL_HIHAT;
+        if (!(r6 & (1 << k))) rel |= 1 << 6;
+        if (!(r7 & (1 << k))) rel |= 1 << 7;
+        metal_rel[k] = rel;
+    }
+#endif
+    SREG = sreg;
+}
+
+// 2^(f/32) for f = 0..31, as 128-251: one octave of decay rates
+const uint8_t decay_exp2[32] PROGMEM = {
+    128, 131, 134, 137, 140, 143, 146, 149, 152, 156, 159, 162, 166, 170, 173, 177,
+    181, 185, 189, 193, 197, 202, 206, 211, 215, 220, 225, 230, 235, 240, 245, 251};
+
+// DECAY_LOG rate -> x_decay (low byte) and x_decay_log2 (high byte):
+// x_decay / 256 * 2^log2 steps per control tick
+static inline uint16_t decay_rate(uint8_t rate)
+{
+    if (rate > DECAY_LOG_MAX)
+        rate = DECAY_LOG_MAX;
+    uint8_t octave = rate / DECAY_LOG_OCTAVE;
+    uint8_t frac = pgm_read_byte(&decay_exp2[rate % DECAY_LOG_OCTAVE]);
+    if (octave < 3)
+        return frac >> (3 - octave);  // Under 1 step per control tick
+    uint8_t log2 = octave - 3;
+
+    // n steps taken at once remove n/128 of the volume, n compounding
+    // ones about (n-1)/256 less (at shift 7): slow the rate to match
+    uint8_t n1 = (1 << log2) - 1;
+    frac -= ((uint16_t)frac * n1) >> 8;
+    return ((uint16_t)log2 << 8) | frac;
+}
+
+// Hi-hat rate: the slower of the DECAY pot and the open/closed cap
+static inline void update_hihat_decay(void)
+{
+    uint16_t r = decay_rate(h_decay_pot < h_decay_speed ? h_decay_pot : h_decay_speed);
+    uint8_t sreg = SREG;
+    cli();
+    h_decay = r;
+    h_decay_log2 = r >> 8;
+    SREG = sreg;
+}
+
+// Map the DECAY pot (0-255) to every voice's decay rate. The kick takes
+// 2, 1 and 0.5 steps per control tick at 42, 127 and 212 (the old 3/7/15
+// settings) and moves smoothly in between; the other voices run an octave
+// faster, up to 4 steps (the old fastest setting).
+static inline void set_param_decay(uint8_t pot)
+{
+    uint8_t rate = 176 - ((uint16_t)pot * 3 + 4) / 8;
+    uint8_t fast = rate + DECAY_LOG_OCTAVE;
+    if (fast > 192)
+        fast = 192;
+    uint16_t k = decay_rate(DECAY_LOG(rate));
+    uint16_t f = decay_rate(DECAY_LOG(fast));
+
+    uint8_t sreg = SREG;
+    cli();
+    param_decay = pot;
+    k_decay = k;
+    k_decay_log2 = k >> 8;
+    s_decay = f;
+    s_decay_log2 = f >> 8;
+    c_decay = f;
+    c_decay_log2 = f >> 8;
+    t_decay = f;
+    t_decay_log2 = f >> 8;
+    cb_decay = f;
+    cb_decay_log2 = f >> 8;
+    h_decay_pot = DECAY_LOG(fast);
+    update_hihat_decay();
+    SREG = sreg;
+}
 
 // Step LFSR and return current value
 static inline uint16_t noise_step(void)
@@ -105,45 +321,228 @@ static inline uint16_t noise_step(void)
     return lfsr;
 }
 
-// --- Sound Synthesis Engine (Inline Functions) ---
+// --- Metal Oscillator Bank (hi-hat, COWBELL=metal cowbell) ---
+// Eight square waves for the cost of one counter: each lane counts down
+// P - 1 .. 0 and flips its bit of metal_out on the step after 0. With the
+// counters bit-sliced, decrementing all lanes is a borrow rippling through
+// the planes, one XOR and one AND each; the lanes that were at 0 borrow
+// out of the top plane. Those read all ones after the wrap, so XOR with
+// the inverted reload value loads P - 1.
+static inline void metal_step(void)
+{
+    uint8_t borrow = 0xFF;
+    for (uint8_t k = 0; k < METAL_BITS; k++) {  // WCET: METAL_BITS
+        uint8_t p = metal_cnt[k] ^ borrow;
+        borrow &= p;
+        metal_cnt[k] = p;
+    }
+    if (borrow) {
+        metal_out ^= borrow;
+        for (uint8_t k = 0; k < METAL_BITS; k++)  // WCET: METAL_BITS
+            metal_cnt[k] ^= metal_rel[k] & borrow;
+    }
+}
 
-// 1. Kick calculation: Sine wave + Pitch sweep + Exponential decay
-static inline int16_t calc_kick()
+#ifdef NOISE_SVF
+// x * f (see svf_coef)
+static inline int16_t svf_scale(int16_t x)
+{
+    x >>= svf_shift;  // WCET: 5
+    uint8_t d = svf_shift2;
+    if (d)
+        x += x >> d;  // WCET: 2
+    return x;
+}
+
+// One filter step on the current LFSR value
+static inline void svf_step(void)
+{
+    int16_t in = (int16_t)lfsr >> 3;
+    int16_t bp = svf_bp;
+    int16_t lp = svf_lp + svf_scale(bp);
+    int16_t hp = in - lp - bp;
+    svf_bp = bp + svf_scale(hp);
+    svf_lp = lp;
+    svf_hp = hp;
+}
+
+// A filter output as 8-bit noise (0-255, centered on 128 like LFSR bits)
+static inline uint8_t svf_noise(uint8_t tap)
 {
-    if (!k_active)
+    int16_t x = (tap == SVF_LP ? svf_lp : tap == SVF_BP ? svf_bp : svf_hp) >> 5;
+    if (x > 127)
+        return 255;
+    if (x < -128)
         return 0;
+    return x + 128;
+}
+#endif
+
+// --- Control Stage (envelopes and pitch sweeps) ---
+// Runs one slot per env tick (see CTRL_SLOTS in voice_params.h), so the
+// per-sample path below is only phase accumulation, lookup and scaling.
+// Decay rates are fractional (see DECAY_LOG): each control tick adds the
+// voice's x_decay to its accumulator, and a carry applies
+// 2^x_decay_log2 steps at once.
+
+// Add rate to a decay accumulator; returns 1 on carry (a step is due)
+static inline uint8_t decay_due(volatile uint8_t *acc, uint8_t rate)
+{
+    uint8_t prev = *acc;
+    uint8_t next = prev + rate;
+    *acc = next;
+    return next < prev;
+}
+
+// 2^steps_log2 decay steps at once: vol -= max(vol >> shift, 1) << steps_log2,
+// stopping at 0. Scaling the per-step amount (rather than shifting less)
+// keeps the truncation of the per-sample envelope in the quiet tail.
+// steps_log2 is at most 3 (DECAY_LOG_MAX): the shift loop's bound.
+static inline uint16_t decay_step(uint16_t vol, uint8_t shift, uint8_t steps_log2)
+{
+    uint16_t decay = vol >> shift;
+    if (decay == 0)
+        decay = 1;
+    decay <<= steps_log2;  // WCET: 3
+    return (vol > decay) ? vol - decay : 0;
+}
 
-    // Pitch sweep downward (proportional - fast at high pitch, slow at low)
-    uint16_t tone_end = param_tone / 20;
-    if (k_step > tone_end) {
-        uint16_t sweep = k_step >> 7;  // ~1% per sample
-        if (sweep == 0) sweep = 1;
-        k_step -= sweep;
+// 1. Kick envelope
+static inline void ctrl_kick(void)
+{
+    if (decay_due(&k_decay_acc, k_decay))
+    {
+        k_vol = decay_step(k_vol, K_DECAY_SHIFT, k_decay_log2);
+        if (k_vol == 0)
+            voice_active &= ~V_KICK;
     }
+}
 
-    // Volume decay
-    static uint8_t k_div = 0;
-    if ((++k_div & k_decay) == 0)
+// 2. Snare envelopes (noise and tonal body)
+static inline void ctrl_snare(void)
+{
+    if (decay_due(&s_decay_acc, s_decay))
     {
-        uint16_t decay = k_vol >> K_DECAY_SHIFT;
-        if (decay == 0 && k_vol > 0)
-            decay = 1;
-        if (k_vol > decay)
-            k_vol -= decay;
-        else
-        {
-            k_vol = 0;
-            k_active = 0;
-        }
+        s_vol = decay_step(s_vol, S_NOISE_SHIFT, s_decay_log2);
+        s_tone_vol = decay_step(s_tone_vol, S_TONE_SHIFT, s_decay_log2);
+
+        // Deactivate when both are done
+        if (s_vol == 0 && s_tone_vol == 0)
+            voice_active &= ~V_SNARE;
     }
+}
+
+// 3. Hi-hat envelope
+static inline void ctrl_hihat(void)
+{
+    if (decay_due(&h_decay_acc, h_decay))
+    {
+        h_vol = decay_step(h_vol, H_DECAY_SHIFT, h_decay_log2);
+        if (h_vol == 0)
+            voice_active &= ~V_HIHAT;
+    }
+}
+
+// 4. Clap envelope (sustain phase only, bursts do not decay)
+static inline void ctrl_clap(void)
+{
+    if (c_stutter > 0)
+        return;
+    if (decay_due(&c_decay_acc, c_decay))
+    {
+        c_vol = decay_step(c_vol, C_DECAY_SHIFT, c_decay_log2);
+        if (c_vol == 0)
+            voice_active &= ~V_CLAP;
+    }
+}
+
+// 5. Tom envelope
+static inline void ctrl_tom(void)
+{
+    if (decay_due(&t_decay_acc, t_decay))
+    {
+        t_vol = decay_step(t_vol, T_DECAY_SHIFT, t_decay_log2);
+        if (t_vol == 0)
+            voice_active &= ~V_TOM;
+    }
+}
+
+// 6. Cowbell envelope
+static inline void ctrl_cowbell(void)
+{
+    if (decay_due(&cb_decay_acc, cb_decay))
+    {
+        cb_vol = decay_step(cb_vol, CB_DECAY_SHIFT, cb_decay_log2);
+        if (cb_vol == 0)
+            voice_active &= ~V_COWBELL;
+    }
+}
+
+// Kick pitch sweep (proportional: fast at high pitch, slow at low),
+// landing exactly on k_tone_end
+static inline void ctrl_kick_sweep(void)
+{
+    if (k_step > k_tone_end)
+    {
+        uint16_t sweep = k_step >> K_SWEEP_SHIFT;
+        if (sweep == 0)
+            sweep = 1;
+        sweep <<= CTRL_SWEEP_SHIFT;  // One env tick's sweep per tick covered
+        k_step = (k_step - k_tone_end > sweep) ? k_step - sweep : k_tone_end;
+    }
+}
+
+// Tom pitch sweep (linear, end point linked to param_tone)
+static inline void ctrl_tom_sweep(void)
+{
+    if (t_step > t_tone_end)
+    {
+        uint16_t sweep = T_SWEEP_DEC;
+#if T_SWEEP_FRAC
+        uint8_t frac = t_sweep_frac + T_SWEEP_FRAC;
+        sweep += (frac < t_sweep_frac);
+        t_sweep_frac = frac;
+#endif
+        t_step = (t_step - t_tone_end > sweep) ? t_step - sweep : t_tone_end;
+    }
+}
+
+// Advance to the next slot and run it (once per env tick)
+static inline void control_update(void)
+{
+    uint8_t slot = (ctrl_slot + 1) & (CTRL_SLOTS - 1);
+    ctrl_slot = slot;
+
+    switch (slot)
+    {
+        case VB_KICK:      if (voice_active & V_KICK) ctrl_kick(); break;
+        case VB_SNARE:     if (voice_active & V_SNARE) ctrl_snare(); break;
+        case VB_HIHAT:     if (voice_active & V_HIHAT) ctrl_hihat(); break;
+        case VB_CLAP:      if (voice_active & V_CLAP) ctrl_clap(); break;
+        case VB_TOM:       if (voice_active & V_TOM) ctrl_tom(); break;
+        case VB_COWBELL:   if (voice_active & V_COWBELL) ctrl_cowbell(); break;
+        case CTRL_SWEEP_A:
+        case CTRL_SWEEP_B:
+            if (voice_active & V_KICK) ctrl_kick_sweep();
+            if (voice_active & V_TOM) ctrl_tom_sweep();
+            break;
+    }
+}
+
+// --- Sound Synthesis Engine (Inline Functions) ---
+
+// 1. Kick calculation: Sine wave (pitch sweep and decay in ctrl_kick*)
+static inline int16_t calc_kick()
+{
+    if (!(voice_active & V_KICK))
+        return 0;
 
     // Waveform generation
     k_phase += k_step;
-    uint8_t raw = pgm_read_byte(&sinewave[(k_phase >> 8) & 0x7F]);
+    uint8_t raw = sine_lookup(k_phase);
     int16_t current = ((raw * (k_vol >> 8)) >> 8);
 
     // Low-pass filter (light: 50% current, 50% previous)
-    static int16_t k_lpf = 0;
     int16_t k_filtered = (current + k_lpf) >> 1;
     k_lpf = current;
 
@@ -153,40 +552,23 @@ static inline int16_t calc_kick()
 // 2. Snare calculation: Tonal body + Noise
 static inline int16_t calc_snare()
 {
-    if (!s_active)
+    if (!(voice_active & V_SNARE))
         return 0;
 
     // Noise generation (LFSR)
     noise_step();
 
-    // Decay for both components
-    static uint8_t s_div = 0;
-    if ((++s_div & s_decay) == 0)
-    {
-        // Noise decay
-        uint16_t decay = s_vol >> S_NOISE_SHIFT;
-        if (decay == 0 && s_vol > 0) decay = 1;
-        if (s_vol > decay) s_vol -= decay;
-        else s_vol = 0;
-
-        // Tone decay
-        uint16_t tone_decay = s_tone_vol >> S_TONE_SHIFT;
-        if (tone_decay == 0 && s_tone_vol > 0) tone_decay = 1;
-        if (s_tone_vol > tone_decay) s_tone_vol -= tone_decay;
-        else s_tone_vol = 0;
-
-        // Deactivate when both are done
-        if (s_vol == 0 && s_tone_vol == 0)
-            s_active = 0;
-    }
-
     // Tonal body (pitch controlled by param_tone, scaled for snare range)
     s_phase += (param_tone >> 1);  // ~150-400Hz range
-    uint8_t tone_raw = pgm_read_byte(&sinewave[(s_phase >> 8) & 0x7F]);
+    uint8_t tone_raw = sine_lookup(s_phase);
     int16_t tone_out = ((tone_raw * (s_tone_vol >> 8)) >> 8);
 
     // Noise output (use 8 bits from LFSR for finer grain)
+#ifdef NOISE_SVF
+    int16_t noise_out = (svf_noise(S_SVF_TAP) * (s_vol >> 8)) >> 8;
+#else
     int16_t noise_out = ((lfsr & 0xFF) * (s_vol >> 8)) >> 8;
+#endif
 
     return tone_out + noise_out;
 }
@@ -194,38 +576,24 @@ static inline int16_t calc_snare()
 // 3. Hi-Hat calculation (Shared for Open/Closed)
 static inline int16_t calc_hihat()
 {
-    if (!h_active)
+    if (!(voice_active & V_HIHAT))
         return 0;
 
     // Noise generation
     noise_step();
 
-    // Volume decay
-    static uint8_t h_div = 0;
-    uint8_t h_decay_mask = h_decay_speed | h_decay;
-    if ((++h_div & h_decay_mask) == 0)
-    {
-        uint16_t h_decay_amt = h_vol >> H_DECAY_SHIFT;
-        if (h_decay_amt == 0 && h_vol > 0)
-            h_decay_amt = 1;
-        if (h_vol > h_decay_amt)
-            h_vol -= h_decay_amt;
-        else
-        {
-            h_vol = 0;
-            h_active = 0;
-        }
-    }
-
-    // Metallic tones (very high freq for sizzle)
-    h_phase1 += 9000;   // ~2740 Hz
-    h_phase2 += 11700;  // ~3560 Hz
-    uint8_t h_tone1 = (h_phase1 >> 8) & 0x80 ? 128 : 0;
-    uint8_t h_tone2 = (h_phase2 >> 8) & 0x80 ? 128 : 0;
-
-    // Mix: tones XOR + noise
-    uint8_t h_metal = (h_tone1 ^ h_tone2) >> 1;  // More metal (was >> 2)
+    // Metallic tone: the six hi-hat lanes ring-modulated in pairs
+    // (0^3, 1^4, 2^5), H_METAL_LEVEL per pair that is high
+    uint8_t ring = metal_out ^ (metal_out >> 3);
+    uint8_t h_metal = 0;
+    if (ring & 1) h_metal += H_METAL_LEVEL;
+    if (ring & 2) h_metal += H_METAL_LEVEL;
+    if (ring & 4) h_metal += H_METAL_LEVEL;
+#ifdef NOISE_SVF
+    uint8_t h_noise = svf_noise(H_SVF_TAP) >> 1;
+#else
     uint8_t h_noise = (lfsr & 0x7F);  // 7-bit noise
+#endif
 
     // Blend: balanced
     int16_t h_out = ((h_metal + h_noise) * (h_vol >> 8)) >> 8;
@@ -233,10 +601,20 @@ static inline int16_t calc_hihat()
     return h_out;
 }
 
+// Clap noise at volume (1-bit LFSR, or the filter's tap)
+static inline int16_t clap_noise(void)
+{
+#ifdef NOISE_SVF
+    return (svf_noise(C_SVF_TAP) * (c_vol >> 8)) >> 8;
+#else
+    return (lfsr & 1) ? (c_vol >> 8) : 0;
+#endif
+}
+
 // 4. Clap calculation: Multiple bursts then decay
 static inline int16_t calc_clap()
 {
-    if (!c_active)
+    if (!(voice_active & V_CLAP))
         return 0;
 
     // Noise generation
@@ -247,112 +625,89 @@ static inline int16_t calc_clap()
     // Stutter phase: 3 short bursts with gaps
     if (c_stutter > 0) {
         // Each burst is ~60 samples on, ~140 samples off (~10ms total per burst)
-        if (c_stutter_timer < 60) {
-            return (lfsr & 1) ? (c_vol >> 8) : 0;
-        } else if (c_stutter_timer > 200) {
+        if (c_stutter_timer < C_BURST_ON) {
+            return clap_noise();
+        } else if (c_stutter_timer > C_BURST_LEN) {
             c_stutter--;
             c_stutter_timer = 0;
         }
         return 0;  // Gap between bursts
     }
 
-    // Sustain phase: normal decay
-    static uint8_t c_div = 0;
-    if ((++c_div & c_decay) == 0)
-    {
-        uint16_t decay = c_vol >> C_DECAY_SHIFT;
-        if (decay == 0 && c_vol > 0)
-            decay = 1;
-        if (c_vol > decay)
-            c_vol -= decay;
-        else
-        {
-            c_vol = 0;
-            c_active = 0;
-        }
-    }
-
-    return (lfsr & 1) ? (c_vol >> 8) : 0;
+    return clap_noise();
 }
 
 // 5. Tom calculation: Similar to kick but higher pitch, faster decay
 static inline int16_t calc_tom()
 {
-    if (!t_active)
+    if (!(voice_active & V_TOM))
         return 0;
 
-    // Pitch sweep downward (end point linked to param_tone)
-    uint16_t tone_end = param_tone / 10;  // Higher end than kick
-    if (t_step > tone_end)
-        t_step--;
-
-    // Volume decay
-    static uint8_t t_div = 0;
-    if ((++t_div & t_decay) == 0)
-    {
-        uint16_t decay = t_vol >> T_DECAY_SHIFT;
-        if (decay == 0 && t_vol > 0)
-            decay = 1;
-        if (t_vol > decay)
-            t_vol -= decay;
-        else
-        {
-            t_vol = 0;
-            t_active = 0;
-        }
-    }
-
     // Waveform generation
     t_phase += t_step;
-    uint8_t raw = pgm_read_byte(&sinewave[(t_phase >> 8) & 0x7F]);
+    uint8_t raw = sine_lookup(t_phase);
     return ((raw * (t_vol >> 8)) >> 8);
 }
 
 // 6. Cowbell calculation: Two detuned oscillators
 static inline int16_t calc_cowbell()
 {
-    if (!cb_active)
+    if (!(voice_active & V_COWBELL))
         return 0;
 
-    // Volume decay
-    static uint8_t cb_div = 0;
-    if ((++cb_div & cb_decay) == 0)
-    {
-        uint16_t decay = cb_vol >> CB_DECAY_SHIFT;
-        if (decay == 0 && cb_vol > 0)
-            decay = 1;
-        if (cb_vol > decay)
-            cb_vol -= decay;
-        else
-        {
-            cb_vol = 0;
-            cb_active = 0;
-        }
-    }
-
+#ifdef COWBELL_METAL
+    // Two square waves from the metal bank (lanes 6 and 7)
+    uint8_t mixed = 0;
+    if (metal_out & 0x40) mixed += CB_METAL_LEVEL;
+    if (metal_out & 0x80) mixed += CB_METAL_LEVEL;
+#else
     // Two oscillators with pitch controlled by param_tone
     // Base: 587Hz and 845Hz, shifted by param_tone
-    uint16_t base_step = 1500 + (param_tone >> 1);  // Pitch shift
+    uint16_t base_step = CB_BASE_STEP + (param_tone >> 1);  // Pitch shift
     cb_phase1 += base_step;
     cb_phase2 += base_step + (base_step >> 1);  // 1.5x ratio for detune
 
-    uint8_t raw1 = pgm_read_byte(&sinewave[(cb_phase1 >> 8) & 0x7F]);
-    uint8_t raw2 = pgm_read_byte(&sinewave[(cb_phase2 >> 8) & 0x7F]);
+    uint8_t raw1 = sine_lookup(cb_phase1);
+    uint8_t raw2 = sine_lookup(cb_phase2);
 
     // Mix both oscillators
     uint16_t mixed = ((uint16_t)raw1 + raw2) >> 1;
+#endif
     return ((mixed * (cb_vol >> 8)) >> 8);
 }
 
-// --- Interrupt Mixer (20kHz) ---
+// --- Interrupt Mixer (SAMPLE_RATE, 20kHz default) ---
+// MIXER=asm replaces this with the hand-scheduled version in mixer.S
+#ifndef MIXER_ASM
 ISR(TIMER0_COMPA_vect)
 {
+    INSTR_ISR_ENTER();
     tick_counter++;
     int16_t output = 0;
 
+#ifdef ENV_FRACTIONAL
+    // Envelope clock: carry out of env_acc = tick
+    uint8_t acc = env_acc + ENV_INC;
+    if (acc < env_acc)
+        voice_active |= V_ENV;
+    else
+        voice_active &= ~V_ENV;
+    env_acc = acc;
+#endif
+
+    if (ENV_TICK())
+        control_update();
+
+#ifdef NOISE_SVF
+    if (voice_active & NOISE_VOICES)
+        svf_step();  // Shared by the snare, hi-hat and clap
+#endif
+
     // Mix all instrument sounds
     output += calc_kick();
     output += calc_snare();
+    if (voice_active & METAL_VOICES)
+        metal_step();  // Shared by the hi-hat and metal cowbell
     output += calc_hihat();
     output += calc_clap();
     output += calc_tom();
@@ -363,12 +718,16 @@ ISR(TIMER0_COMPA_vect)
     output = output >> 1;
 
     // Clipping if still exceeds 255
-    if (output > 255)
+    if (output > 255) {
         output = 255;
+        MIXER_CLIP_HOOK();
+    }
 
     // PWM output (OC1A = PB1)
     OCR1A = (uint8_t)output;
+    INSTR_ISR_EXIT();
 }
+#endif // MIXER_ASM
 
 // --- Accent Helper ---
 // Scale volume by accent (0-65535), returns scaled value
@@ -380,7 +739,7 @@ static inline uint16_t scale_vol(uint16_t base_vol, uint16_t accent)
 // --- Trigger Functions with Accent ---
 static inline void trigger_kick_accent(uint16_t accent)
 {
-    k_active = 1;
+    voice_active |= V_KICK;
     k_vol = accent;  // Kick uses accent directly (max volume voice)
     k_step = param_tone;
     // k_phase not reset - avoids click on retrigger
@@ -388,7 +747,7 @@ static inline void trigger_kick_accent(uint16_t accent)
 
 static inline void trigger_snare_accent(uint16_t accent)
 {
-    s_active = 1;
+    voice_active |= V_SNARE;
     s_vol = scale_vol(S_VOL_INIT, accent);
     s_tone_vol = scale_vol(S_TONE_VOL_INIT, accent);
     s_phase = 0x6000;
@@ -396,35 +755,34 @@ static inline void trigger_snare_accent(uint16_t accent)
 
 static inline void trigger_hihat_accent(uint16_t accent)
 {
-    h_active = 1;
+    voice_active |= V_HIHAT;
     h_vol = scale_vol(H_VOL_INIT, accent);
-    h_phase1 = 0;
-    h_phase2 = 0;
+    // Metal bank runs free, like the analog oscillators
 }
 
 static inline void trigger_clap_accent(uint16_t accent)
 {
-    if (!c_active) {
+    if (!(voice_active & V_CLAP)) {
         // Fresh trigger: do stutter
         c_stutter = 3;
         c_stutter_timer = 0;
     }
     // Retrigger while active: skip stutter, just boost volume
-    c_active = 1;
+    voice_active |= V_CLAP;
     c_vol = scale_vol(C_VOL_INIT, accent);
 }
 
 static inline void trigger_tom_accent(uint16_t accent)
 {
-    t_active = 1;
+    voice_active |= V_TOM;
     t_vol = scale_vol(T_VOL_INIT, accent);
-    t_step = param_tone + 200;
+    t_step = param_tone + T_STEP_OFFSET;
     t_phase = 0x6000;
 }
 
 static inline void trigger_cowbell_accent(uint16_t accent)
 {
-    cb_active = 1;
+    voice_active |= V_COWBELL;
     cb_vol = scale_vol(CB_VOL_INIT, accent);
     cb_phase1 = 0x6000;
     cb_phase2 = 0x6000;
@@ -449,13 +807,15 @@ static inline void trigger_hihat(void)
 
 static inline void trigger_hihat_closed(void)
 {
-    h_decay_speed = 1;
+    h_decay_speed = DECAY_LOG(192);
+    update_hihat_decay();
     trigger_hihat_accent(65535);
 }
 
 static inline void trigger_hihat_open(void)
 {
-    h_decay_speed = 7;
+    h_decay_speed = DECAY_LOG(128);
+    update_hihat_decay();
     trigger_hihat_accent(65535);
 }
 
@@ -463,7 +823,7 @@ static inline void trigger_clap(void)
 {
     c_stutter = 3;
     c_stutter_timer = 0;
-    c_active = 1;
+    voice_active |= V_CLAP;
     c_vol = C_VOL_INIT;
 }
 
@@ -516,11 +876,52 @@ static inline void trigger_current_voice(void)
     trigger_current_voice_with_accent(65535);
 }
 
+// Scale a volume the ISR is decaying by q / 256. The product is worked out
+// with interrupts on; the decay applied meanwhile comes off the result.
+static inline void rescale_vol(volatile uint16_t *vol, uint16_t q)
+{
+    uint8_t sreg = SREG;
+    cli();
+    uint16_t v0 = *vol;
+    SREG = sreg;
+    uint32_t v = ((uint32_t)v0 * q) >> 8;
+    if (v > 65535)
+        v = 65535;
+    cli();
+    uint16_t decayed = v0 - *vol;
+    *vol = (v > decayed) ? v - decayed : 0;
+    SREG = sreg;
+}
+
+// Correct the current voice from accent `from` (what it was triggered
+// with) to `to`, shortly after the trigger (main.c's accent window)
+static inline void rescale_current_voice(uint16_t from, uint16_t to)
+{
+    uint16_t q = ((uint32_t)to << 8) / from;
+    switch (current_voice) {
+        case 0: rescale_vol(&k_vol, q); break;
+        case 1: rescale_vol(&s_vol, q); rescale_vol(&s_tone_vol, q); break;
+        case 2: rescale_vol(&h_vol, q); break;
+        case 3: rescale_vol(&c_vol, q); break;
+        case 4: rescale_vol(&t_vol, q); break;
+        case 5: rescale_vol(&cb_vol, q); break;
+    }
+}
+
 // --- Utility Functions ---
+// Mixer ticks in ms milliseconds
+static inline uint16_t ms_to_ticks(uint16_t ms)
+{
+#if MIX_RATE % 1000 == 0
+    return ms * (MIX_RATE / 1000);
+#else
+    return ((uint32_t)ms * MIX_RATE + 500) / 1000;
+#endif
+}
+
 static inline void wait_exact_ms(uint16_t ms)
 {
-    // 20kHz, so 1ms = 20 counts
-    uint16_t target_ticks = ms * 20;
+    uint16_t target_ticks = ms_to_ticks(ms);
     tick_counter = 0;
     while (tick_counter < target_ticks)
     {
@@ -0,0 +1,455 @@
+"""AVR assembler and simulator for the subset mixer.S uses (tools/mixcheck.py).
+
+Asm takes preprocessed GNU as source (macros, .if/.else, .rept, numeric
+local labels, lo8()/hi8()) and lays out .init8 then .text as one
+instruction per slot; external symbols are SRAM addresses passed in. The
+preprocessor's line markers, if kept, give each instruction its source
+line, and Asm.listing() writes the code as avr-objdump -d -l would for
+tools/wcet.py (byte addresses, targets resolved, no encodings). Cpu
+executes it with AVRe cycle counts (ATtiny85: rcall 3, ret/reti 4, lpm 3,
+two-word skips 3) on a flat data space where registers sit at 0-31 and
+I/O at 0x20-0x5F; only SREG is special. ld/st and anything outside the
+subset raise NotImplementedError rather than guess.
+"""
+
+import os
+import re
+
+REG = re.compile(r"^r(\d+)$", re.I)
+LINE_MARKER = re.compile(r'^#\s*(\d+)\s+"([^"]*)"')
+
+
+class Asm:
+    """Preprocessed source -> one instruction per slot (Asm.code)."""
+
+    def __init__(self, text, symbols):
+        self.symbols = dict(symbols)  # External: name -> data address
+        self.macros = {}
+        self.lines = []
+        self.macro_count = 0
+        self.expand(text.split("\n"))
+        self.assemble()
+
+    def strip(self, l):
+        # ';' comments (mixer.S has no strings)
+        i = l.find(";")
+        if i >= 0:
+            l = l[:i]
+        return l.strip()
+
+    def expand(self, lines):
+        # Lines become (text, (file, line)); where stays None without markers
+        pos = [None, 0]
+
+        def located(it):
+            for raw in it:
+                m = LINE_MARKER.match(raw)
+                if m:
+                    pos[:] = [m.group(2), int(m.group(1))]
+                    continue
+                where = (pos[0], pos[1]) if pos[0] else None
+                pos[1] += 1
+                yield self.strip(raw), where
+
+        it = located(lines)
+        for l, where in it:
+            if not l:
+                continue
+            if l.startswith(".macro"):
+                parts = l[6:].replace(",", " ").split()
+                name, params = parts[0], parts[1:]
+                body = []
+                for l2, where2 in it:
+                    if l2.startswith(".endm"):
+                        break
+                    body.append((l2, where2))
+                self.macros[name] = (params, body)
+                continue
+            self.lines.append((l, where))
+
+    def substitute(self, body, params, args):
+        self.macro_count += 1
+        out = []
+        for l, where in body:
+            for p, a in sorted(zip(params, args), key=lambda x: -len(x[0])):
+                l = l.replace("\\" + p, a)
+            l = l.replace("\\@", str(self.macro_count))
+            out.append((l, where))
+        return out
+
+    def flatten(self, lines):
+        out = []
+        cond = []
+        i = 0
+        while i < len(lines):
+            l, where = lines[i]
+            i += 1
+            if l.startswith(".if "):
+                active = all(cond) and bool(self.eval(l[4:], {}))
+                cond.append(active)
+                continue
+            if l.startswith(".else"):
+                cond[-1] = not cond[-1] and all(cond[:-1])
+                continue
+            if l.startswith(".endif"):
+                cond.pop()
+                continue
+            if not all(cond):
+                continue
+            if l.startswith(".rept"):
+                n = self.eval(l[5:], {})
+                body = []
+                depth = 1
+                while True:
+                    l2 = lines[i]; i += 1
+                    if l2[0].startswith(".rept"): depth += 1
+                    if l2[0].startswith(".endr"):
+                        depth -= 1
+                        if depth == 0: break
+                    body.append(l2)
+                out += self.flatten(body * n)
+                continue
+            m = re.match(r"^(\w+)\s*(.*)$", l)
+            if m and m.group(1) in self.macros:
+                params, body = self.macros[m.group(1)]
+                args = [a.strip() for a in m.group(2).split(",")] if m.group(2).strip() else []
+                out += self.flatten(self.substitute(body, params, args))
+                continue
+            out.append((l, where))
+        return out
+
+    def eval(self, e, labels, pc=None):
+        e = e.strip()
+        e = re.sub(r"\blo8\(", "_lo8(", e)
+        e = re.sub(r"\bhi8\(", "_hi8(", e)
+        env = {"_lo8": lambda x: x & 0xFF, "_hi8": lambda x: (x >> 8) & 0xFF}
+        env.update(self.symbols)
+        env.update(labels)
+        if pc is not None:
+            e = re.sub(r"^\.", str(pc), e)
+        e = re.sub(r"0x([0-9a-fA-F]+)", lambda m: str(int(m.group(1), 16)), e)
+        e = re.sub(r"(?<!/)/(?!/)", "//", e)
+        return int(eval(e, {}, env))
+
+    def assemble(self):
+        lines = self.flatten(self.lines)
+        # pass 1: sections & labels; only .text and .init8 go into "flash"
+        prog = {".text": [], ".init8": []}
+        labels = {}
+        sec = ".text"
+        for l, where in lines:
+            if l.startswith(".section"):
+                sec = ".init8" if ".init8" in l else ".other"
+                prog.setdefault(sec, [])
+                continue
+            if l == ".text":
+                sec = ".text"; continue
+            if l.startswith(".") and not re.match(r"^[\w.]+:", l):
+                continue
+            while True:
+                m = re.match(r"^([\w.]+):\s*(.*)$", l)
+                if not m: break
+                prog[sec].append(("label", m.group(1)))
+                l = m.group(2)
+            if l:
+                prog[sec].append(("insn", (l, where)))
+        self.sections = {}
+        for sec, items in prog.items():
+            insns = []
+            lab = {}
+            numeric = []  # (name, index)
+            for kind, v in items:
+                if kind == "label":
+                    if v.isdigit():
+                        numeric.append((v, len(insns)))
+                    else:
+                        lab[v] = len(insns)
+                else:
+                    insns.append(v)
+            self.sections[sec] = (insns, lab, numeric)
+        # flatten into one flash image: init8 at 0x0000.. , text after
+        self.code = []  # list of (mnemonic, operands, index, ..., where)
+        self.addr_of = {}
+        base = 0
+        self.label_addr = {}
+        for sec in (".init8", ".text"):
+            insns, lab, numeric = self.sections[sec]
+            for k, v in lab.items():
+                self.label_addr[k] = base + v
+            self.sections[sec] = (insns, lab, numeric, base)
+            base += len(insns)
+        for sec in (".init8", ".text"):
+            insns, lab, numeric, b = self.sections[sec]
+            for idx, (l, where) in enumerate(insns):
+                m = re.match(r"^(\w+)\s*(.*)$", l)
+                mn, ops = m.group(1).lower(), m.group(2)
+                ops = [o.strip() for o in ops.split(",")] if ops.strip() else []
+                self.code.append((mn, ops, sec, idx, numeric, b, where))
+        self.init_end = len(self.sections[".init8"][0])
+
+    def resolve_label(self, op, i):
+        mn, ops, sec, idx, numeric, b, _ = self.code[i]
+        m = re.match(r"^(\d+)([fb])$", op)
+        if m:
+            n, d = m.group(1), m.group(2)
+            if d == "f":
+                cands = [x for nm, x in numeric if nm == n and x > idx]
+                return b + min(cands)
+            cands = [x for nm, x in numeric if nm == n and x <= idx]
+            return b + max(cands)
+        m = re.match(r"^\.\+(\d+)$", op)
+        if m:
+            # words: each insn here is one slot; assume 1-word skipped instructions
+            return i + 1 + int(m.group(1)) // 2
+        return self.label_addr[op]
+
+
+    def listing(self):
+        """The code as avr-objdump -d -l text: labels as symbols, line info,
+        branch targets as addresses, zero bytes for the encodings."""
+        addr, a = [], 0
+        for mn, *_ in self.code:
+            addr.append(a)
+            a += 4 if mn in TWO_WORD else 2
+        names = {}
+        for name, i in self.label_addr.items():
+            if not name.startswith("."):
+                names.setdefault(i, []).append(name)
+        out, last = [], None
+        for i, (mn, ops, *_, where) in enumerate(self.code):
+            for name in names.get(i, []):
+                out.append("%08x <%s>:" % (addr[i], name))
+                last = None
+            if where and where != last:
+                out.append("%s:%d" % (os.path.abspath(where[0]), where[1]))
+                last = where
+            if mn in TARGETED and ops:
+                ops = ops[:-1] + ["0x%x" % addr[self.resolve_label(ops[-1], i)]]
+            size = 4 if mn in TWO_WORD else 2
+            out.append("%8x:\t%s\t%s\t%s" % (addr[i], "00 " * size, mn, ", ".join(ops)))
+        return "\n".join(out) + "\n"
+
+
+TWO_WORD = {"lds", "sts", "call", "jmp"}
+TARGETED = set(("rjmp jmp rcall call brbs brbc breq brne brcs brcc brsh brlo brmi brpl "
+                "brge brlt brhs brhc brts brtc brvs brvc brie brid").split())
+
+
+class Cpu:
+    """Executes Asm.code; cycles accumulates AVRe cycle counts."""
+
+    def __init__(self, asm, data_size=0x800, flash_tables=None):
+        self.asm = asm
+        self.r = [0] * 32
+        self.data = bytearray(data_size)
+        self.flash = flash_tables or {}
+        self.C = self.Z = self.N = self.V = self.S = self.H = self.T = self.I = 0
+        self.sp = data_size - 1
+        self.cycles = 0
+
+    def reg(self, s):
+        m = REG.match(s)
+        return int(m.group(1))
+
+    def imm(self, s):
+        return self.asm.eval(s, self.asm.label_addr) & 0xFFFF
+
+    def io(self, s):
+        return self.asm.eval(s, {}) + 0x20
+
+    def sreg(self):
+        return (self.I << 7) | (self.T << 6) | (self.H << 5) | (self.S << 4) | (self.V << 3) | (self.N << 2) | (self.Z << 1) | self.C
+
+    def set_sreg(self, v):
+        self.I, self.T, self.H, self.S, self.V, self.N, self.Z, self.C = [(v >> b) & 1 for b in (7, 6, 5, 4, 3, 2, 1, 0)]
+
+    def rd(self, a):
+        if a < 32: return self.r[a]
+        if a == 0x5F: return self.sreg()
+        return self.data[a]
+
+    def wr(self, a, v):
+        v &= 0xFF
+        if a < 32: self.r[a] = v; return
+        if a == 0x5F: self.set_sreg(v); return
+        self.data[a] = v
+        if hasattr(self, "on_write"):
+            self.on_write(a, v)
+
+    def flags_logic(self, res):
+        self.V = 0
+        self.N = (res >> 7) & 1
+        self.Z = int(res == 0)
+        self.S = self.N ^ self.V
+
+    def flags_add(self, a, b, c, res):
+        r = res & 0xFF
+        self.H = (((a & b) | (b & ~r) | (~r & a)) >> 3) & 1
+        self.C = (((a & b) | (b & ~r) | (~r & a)) >> 7) & 1
+        self.V = (((a & b & ~r) | (~a & ~b & r)) >> 7) & 1
+        self.N = (r >> 7) & 1
+        self.Z = int(r == 0)
+        self.S = self.N ^ self.V
+
+    def flags_sub(self, a, b, r, keepz=False):
+        r &= 0xFF
+        self.H = (((~a & b) | (b & r) | (r & ~a)) >> 3) & 1
+        self.C = (((~a & b) | (b & r) | (r & ~a)) >> 7) & 1
+        self.V = (((a & ~b & ~r) | (~a & b & r)) >> 7) & 1
+        self.N = (r >> 7) & 1
+        if keepz:
+            self.Z = int(r == 0) & self.Z
+        else:
+            self.Z = int(r == 0)
+        self.S = self.N ^ self.V
+
+    def push(self, v):
+        self.data[self.sp] = v & 0xFF; self.sp -= 1
+
+    def pop(self):
+        self.sp += 1; return self.data[self.sp]
+
+    def run(self, start_label=None, start=None, stop_at_ret=True, max_steps=100000):
+        pc = start if start is not None else self.asm.label_addr[start_label]
+        code = self.asm.code
+        steps = 0
+        while True:
+            steps += 1
+            if steps > max_steps: raise RuntimeError("runaway")
+            if pc >= len(code):
+                return "end"
+            if pc == self.asm.init_end and start == 0:
+                return "init_done"
+            mn, ops, *_ = code[pc]
+            npc = pc + 1
+            cyc = 1
+            R = self.r
+            if mn == "ldi":
+                R[self.reg(ops[0])] = self.imm(ops[1]) & 0xFF
+            elif mn == "mov":
+                R[self.reg(ops[0])] = R[self.reg(ops[1])]
+            elif mn == "movw":
+                d, s = self.reg(ops[0]), self.reg(ops[1])
+                R[d], R[d + 1] = R[s], R[s + 1]
+            elif mn in ("add", "adc", "lsl", "rol"):
+                d = self.reg(ops[0]); s = d if mn in ("lsl", "rol") else self.reg(ops[1])
+                c = self.C if mn in ("adc", "rol") else 0
+                a, b = R[d], R[s]
+                res = a + b + c
+                self.flags_add(a, b, c, res)
+                R[d] = res & 0xFF
+            elif mn in ("sub", "sbc", "subi", "sbci", "cp", "cpc", "cpi"):
+                d = self.reg(ops[0])
+                b = self.imm(ops[1]) & 0xFF if mn in ("subi", "sbci", "cpi") else R[self.reg(ops[1])]
+                c = self.C if mn in ("sbc", "sbci", "cpc") else 0
+                a = R[d]
+                res = (a - b - c) & 0xFF
+                self.flags_sub(a, b, res, keepz=mn in ("sbc", "sbci", "cpc"))
+                if mn not in ("cp", "cpc", "cpi"):
+                    R[d] = res
+            elif mn in ("and", "andi", "or", "ori", "eor", "tst", "clr"):
+                d = self.reg(ops[0])
+                if mn == "tst": v = R[d]
+                elif mn == "clr": v = 0
+                else:
+                    b = self.imm(ops[1]) & 0xFF if mn in ("andi", "ori") else R[self.reg(ops[1])]
+                    v = {"and": R[d] & b, "andi": R[d] & b, "or": R[d] | b, "ori": R[d] | b, "eor": R[d] ^ b}[mn]
+                self.flags_logic(v)
+                if mn != "tst": R[d] = v
+            elif mn in ("lsr", "ror", "asr"):
+                d = self.reg(ops[0]); a = R[d]
+                cin = self.C if mn == "ror" else (a >> 7 if mn == "asr" else 0)
+                self.C = a & 1
+                v = (a >> 1) | (cin << 7)
+                R[d] = v
+                self.N = (v >> 7) & 1; self.Z = int(v == 0); self.V = self.N ^ self.C; self.S = self.N ^ self.V
+            elif mn in ("inc", "dec"):
+                d = self.reg(ops[0]); a = R[d]
+                v = (a + 1) & 0xFF if mn == "inc" else (a - 1) & 0xFF
+                self.V = int(a == (0x7F if mn == "inc" else 0x80))
+                R[d] = v; self.N = v >> 7; self.Z = int(v == 0); self.S = self.N ^ self.V
+            elif mn == "com":
+                d = self.reg(ops[0]); v = (~R[d]) & 0xFF; R[d] = v
+                self.flags_logic(v); self.C = 1
+            elif mn == "neg":
+                d = self.reg(ops[0]); a = R[d]; v = (-a) & 0xFF
+                self.flags_sub(0, a, v); R[d] = v
+            elif mn == "swap":
+                d = self.reg(ops[0]); a = R[d]; R[d] = ((a << 4) | (a >> 4)) & 0xFF
+            elif mn in ("adiw", "sbiw"):
+                d = self.reg(ops[0]); k = self.imm(ops[1])
+                a = R[d] | (R[d + 1] << 8)
+                v = (a + k) if mn == "adiw" else (a - k)
+                self.C = int(v > 0xFFFF or v < 0)
+                v &= 0xFFFF
+                self.Z = int(v == 0); self.N = v >> 15
+                self.V = ((~a & v) >> 15) & 1 if mn == "adiw" else ((a & ~v) >> 15) & 1
+                self.S = self.N ^ self.V
+                R[d], R[d + 1] = v & 0xFF, v >> 8
+                cyc = 2
+            elif mn == "lds":
+                R[self.reg(ops[0])] = self.rd(self.imm(ops[1])); cyc = 2
+            elif mn == "sts":
+                self.wr(self.imm(ops[0]), R[self.reg(ops[1])]); cyc = 2
+            elif mn in ("ld", "st", "ldd", "std"):
+                raise NotImplementedError(mn)
+            elif mn == "in":
+                R[self.reg(ops[0])] = self.rd(self.io(ops[1]))
+            elif mn == "out":
+                self.wr(self.io(ops[0]), R[self.reg(ops[1])])
+            elif mn == "push":
+                self.push(R[self.reg(ops[0])]); cyc = 2
+            elif mn == "pop":
+                R[self.reg(ops[0])] = self.pop(); cyc = 2
+            elif mn == "lpm":
+                d = self.reg(ops[0]) if ops else 0
+                z = R[30] | (R[31] << 8)
+                R[d] = self.flash.get(z, 0); cyc = 3
+                if len(ops) > 1 and ops[1].upper() == "Z+":
+                    z += 1; R[30], R[31] = z & 0xFF, z >> 8
+            elif mn in ("clt", "set", "clc", "sec", "cli", "sei", "nop"):
+                if mn == "clt": self.T = 0
+                elif mn == "set": self.T = 1
+                elif mn == "clc": self.C = 0
+                elif mn == "sec": self.C = 1
+            elif mn == "bld":
+                d = self.reg(ops[0]); b = self.imm(ops[1])
+                R[d] = (R[d] & ~(1 << b)) | (self.T << b)
+            elif mn == "bst":
+                d = self.reg(ops[0]); b = self.imm(ops[1]); self.T = (R[d] >> b) & 1
+            elif mn == "cpse":
+                if R[self.reg(ops[0])] == R[self.reg(ops[1])]:
+                    nmn = code[pc + 1][0]
+                    npc = pc + 2
+                    cyc = 3 if nmn in TWO_WORD else 2
+            elif mn in ("sbrc", "sbrs"):
+                d = self.reg(ops[0]); b = self.imm(ops[1])
+                bit = (R[d] >> b) & 1
+                if (mn == "sbrc" and bit == 0) or (mn == "sbrs" and bit == 1):
+                    nmn = code[pc + 1][0]
+                    npc = pc + 2
+                    cyc = 3 if nmn in TWO_WORD else 2
+            elif mn in ("breq", "brne", "brcs", "brcc", "brlo", "brsh", "brmi", "brpl", "brge", "brlt", "brts", "brtc"):
+                cond = {"breq": self.Z, "brne": not self.Z, "brcs": self.C, "brlo": self.C,
+                        "brcc": not self.C, "brsh": not self.C, "brmi": self.N, "brpl": not self.N,
+                        "brge": not self.S, "brlt": self.S, "brts": self.T, "brtc": not self.T}[mn]
+                if cond:
+                    npc = self.asm.resolve_label(ops[0], pc); cyc = 2
+            elif mn == "rjmp":
+                npc = self.asm.resolve_label(ops[0], pc); cyc = 2
+            elif mn == "rcall":
+                self.push(0); self.push(0)
+                self.callstack = getattr(self, "callstack", []) + [pc + 1]
+                npc = self.asm.resolve_label(ops[0], pc); cyc = 3
+            elif mn == "ret":
+                if getattr(self, "callstack", []):
+                    npc = self.callstack.pop(); self.pop(); self.pop(); cyc = 4
+                else:
+                    self.cycles += 4; return "ret"
+            elif mn == "reti":
+                self.cycles += 4
+                return "reti"
+            else:
+                raise NotImplementedError(mn + " " + str(ops))
+            self.cycles += cyc
+            pc = npc
@@ -0,0 +1,138 @@
+#!/usr/bin/env python3
+"""Collect TinyTR firmware benchmarks and compare them against a baseline.
+
+Run through `make bench` in firmware/sim, which builds both firmwares and
+the simavr harness first:
+
+    make -C firmware/sim bench                 # writes /bench_output.txt
+    make -C firmware/sim bench-baseline        # adopt it as the baseline
+
+Metrics (one "name value" per line):
+  <chip>.text/.data/.bss     section sizes from avr-size (bytes)
+  <chip>.stack               stack bytes ever used (simavr, whole run)
+  <chip>.<window>.isr_*      Timer0 ISR cycles min/avg/max (sim/avrbench.c)
+  <chip>.boot.*_us           reset to first tick / audio ready / first step
+
+A metric regresses when it grows past its threshold: ISR cycles and boot
+times by more than --cycles-pct percent (and at least one cycle or us),
+sizes and stack by more than --bytes. The exit status is 1 on any
+regression, 2 without a baseline to compare against: the run is still
+written, for make bench-baseline to adopt.
+"""
+
+import argparse
+import os
+import subprocess
+import sys
+
+SECTIONS = (".text", ".data", ".bss")
+
+
+def section_sizes(size_tool, elf):
+    """Section sizes of an ELF from `avr-size -A`."""
+    out = subprocess.check_output([size_tool, "-A", elf], text=True)
+    sizes = {}
+    for line in out.splitlines():
+        parts = line.split()
+        if len(parts) >= 2 and parts[0] in SECTIONS:
+            sizes[parts[0]] = int(parts[1])
+    return {s: sizes.get(s, 0) for s in SECTIONS}
+
+
+def run_avrbench(avrbench, which, elf, f_cpu):
+    """Metrics printed by sim/avrbench."""
+    out = subprocess.check_output([avrbench, which, elf, "-f", str(f_cpu)], text=True)
+    return parse_metrics(out.splitlines())
+
+
+def parse_metrics(lines):
+    metrics = {}
+    for line in lines:
+        line = line.split("#", 1)[0].strip()
+        if not line:
+            continue
+        name, value = line.split()
+        metrics[name] = float(value)
+    return metrics
+
+
+def threshold(name, base, args):
+    """Allowed growth for a metric, or None if it is informational."""
+    if (".isr_" in name and not name.endswith(".isr_count")) or ".boot." in name:
+        return max(1.0, base * args.cycles_pct / 100.0)
+    if name.endswith(SECTIONS) or name.endswith(".stack"):
+        return args.bytes
+    return None
+
+
+def fmt(v):
+    return "%d" % v if v == int(v) else "%.1f" % v
+
+
+def compare(base, now, args):
+    regressions = 0
+    print("%-28s %10s %10s %9s" % ("metric", "baseline", "now", "delta"))
+    for name in sorted(now):
+        if name not in base:
+            print("%-28s %10s %10s %9s  new" % (name, "-", fmt(now[name]), ""))
+            continue
+        b, n = base[name], now[name]
+        limit = threshold(name, b, args)
+        d = n - b
+        flag = ""
+        if limit is not None and d > limit:
+            flag = "  REGRESSION (limit +%s)" % fmt(limit)
+            regressions += 1
+        elif d < 0:
+            flag = "  better"
+        pct = " (%+.1f%%)" % (100.0 * d / b) if b else ""
+        delta = ("+" if d >= 0 else "") + fmt(d)
+        print("%-28s %10s %10s %9s%s%s" % (name, fmt(b), fmt(n), delta, pct, flag))
+    for name in sorted(set(base) - set(now)):
+        print("%-28s %10s %10s %9s  gone" % (name, fmt(base[name]), "-", ""))
+    return regressions
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__,
+                                 formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--synth", required=True, help="synthesizer main.elf")
+    ap.add_argument("--seq", required=True, help="sequencer main.elf")
+    ap.add_argument("--avrbench", default="./avrbench", help="simavr harness")
+    ap.add_argument("--size", default="avr-size", help="avr-size binary")
+    ap.add_argument("--f-cpu", type=int, default=8000000, help="CPU clock (Hz)")
+    ap.add_argument("-o", "--output", required=True, help="metrics file to write")
+    ap.add_argument("--baseline", help="metrics file to compare against")
+    ap.add_argument("--cycles-pct", type=float, default=2.0,
+                    help="allowed ISR cycle growth in percent (default 2)")
+    ap.add_argument("--bytes", type=float, default=16,
+                    help="allowed size/stack growth in bytes (default 16)")
+    args = ap.parse_args()
+
+    now = {}
+    for chip, elf in (("synth", args.synth), ("seq", args.seq)):
+        for s, v in section_sizes(args.size, elf).items():
+            now[chip + s] = v
+        now.update(run_avrbench(args.avrbench, chip, elf, args.f_cpu))
+
+    with open(args.output, "w") as f:
+        f.write("# TinyTR bench, F_CPU %d\n" % args.f_cpu)
+        for name in sorted(now):
+            f.write("%s %s\n" % (name, fmt(now[name])))
+
+    if not args.baseline or not os.path.exists(args.baseline):
+        for name in sorted(now):
+            print("%-28s %10s" % (name, fmt(now[name])))
+        print("bench: no baseline %s (make bench-baseline records one)"
+              % (args.baseline or ""), file=sys.stderr)
+        return 2
+
+    with open(args.baseline) as f:
+        base = parse_metrics(f)
+    regressions = compare(base, now, args)
+    print("%d regression(s) against %s" % (regressions, args.baseline))
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,309 @@
+#!/usr/bin/env python3
+"""Check mixer.S against the C mixer and measure its cycles, without avr-gcc.
+
+Run through `make mixcheck` in firmware/sim, which builds the C mixer of
+synthesizer/voices.h as a shared library (sim/mixref.c) with the same
+options first:
+
+    make -C firmware/sim mixcheck                        # 20000 samples
+    make -C firmware/sim mixcheck SAMPLE_RATE=32000 COWBELL=metal ARGS="--fuzz"
+    make -C firmware/sim mixcheck ARGS="--table"         # cycle table
+
+mixer.S is preprocessed with the host compiler and run on tools/avrasm.py.
+Before each sample the C globals are copied into the simulated SRAM (and
+r3, r4:r5, r10:r11 for voice_active, lfsr, k_phase); both ISRs run, then
+every global, OCR1A, SREG, the pushed registers and SP must match. Random
+triggers, TONE and DECAY changes drive the voices; --fuzz also scrambles
+the state between samples. Cycles run from the interrupt response (4) and
+the vector's rjmp (2) to the reti.
+
+--table prints the worst cycles over 400 random states for each path
+(idle, each voice's audio and own envelope slot, the sweep slots, all six
+per slot, clap bursts), the figures quoted in mixer.S. --listing writes
+mixer.S for tools/wcet.py, which bounds it statically (make mixwcet).
+Exit status: 0 if every sample matched, 1 on a mismatch, 2 if the
+harness could not run.
+"""
+
+import argparse
+import ctypes
+import os
+import random
+import subprocess
+import sys
+import tempfile
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from avrasm import Asm, Cpu  # noqa: E402
+
+# Data-space addresses mixer.S reaches through <avr/io.h> (ATtiny85)
+IO_H = """\
+#define _SFR_IO_ADDR(x) ((x) - 0x20)
+#define SREG 0x5F
+#define OCR1A 0x4E
+#define TIMER0_COMPA_vect __vector_10
+"""
+DATA_OCR1A = 0x4E
+RAM_START = 0x60
+FLASH_TABLES = 0x1000
+STACK_TOP = 0x7FF
+
+# Globals held in reserved registers by mixer.S: name -> (first register, bytes)
+REGVARS = {"voice_active": (3, 1), "lfsr": (4, 2), "k_phase": (10, 2)}
+# Registers the ISR must give back unchanged (the rest are reserved or unused)
+SAVED = (0, 1, 16, 17, 24, 25, 30, 31)
+# Host stand-ins from sim/mixref.c, not mixer state
+HOST_ONLY = {"SREG", "DDRB", "PORTB", "PINB", "sim_pwm", "sim_clips"}
+# Derived from TONE by set_param_tone(); scrambling them breaks the sweeps' ranges
+FUZZ_KEEP = ("param_tone", "k_tone_end", "t_tone_end")
+VOICES = ("k", "s", "h", "c", "t", "cb")
+NAMES = ("kick", "snare", "hihat", "clap", "tom", "cowbell")
+
+
+def symbols(lib_path):
+    """Global data and rodata of the library: [(name, size, rodata)]."""
+    out = subprocess.check_output(["nm", "-S", "--defined-only", lib_path], text=True)
+    syms = []
+    for line in out.splitlines():
+        parts = line.split()
+        if len(parts) != 4 or parts[2] not in "BDR" or parts[3] in HOST_ONLY:
+            continue
+        syms.append((parts[3], int(parts[1], 16), parts[2] == "R"))
+    return sorted(syms)
+
+
+class Var:
+    """A C global as little-endian bytes (the AVR layout too)."""
+
+    def __init__(self, lib, name, size):
+        self.a = (ctypes.c_uint8 * size).in_dll(lib, name)
+        self.size = size
+
+    @property
+    def value(self):
+        return sum(self.a[i] << (8 * i) for i in range(self.size))
+
+    @value.setter
+    def value(self, v):
+        for i in range(self.size):
+            self.a[i] = (v >> (8 * i)) & 0xFF
+
+
+class Harness:
+    def __init__(self, lib_path, mixer, incdirs, defines):
+        self.lib = ctypes.CDLL(os.path.abspath(lib_path))
+        self.state = []
+        addr, flash = {}, {}
+        ram, rom = RAM_START, FLASH_TABLES
+        for name, size, rodata in symbols(lib_path):
+            if rodata:
+                table = (ctypes.c_uint8 * size).in_dll(self.lib, name)
+                for i in range(size):
+                    flash[rom + i] = table[i]
+                addr[name] = rom
+                rom += size
+                continue
+            self.state.append((name, size))
+            if name not in REGVARS:
+                addr[name] = ram
+                ram += size
+        self.addr = addr
+        self.vars = {n: Var(self.lib, n, s) for n, s in self.state}
+        self.ocr1a = ctypes.c_uint8.in_dll(self.lib, "sim_pwm")
+
+        with tempfile.TemporaryDirectory() as inc:
+            os.mkdir(os.path.join(inc, "avr"))
+            with open(os.path.join(inc, "avr", "io.h"), "w") as f:
+                f.write(IO_H)
+            cmd = ["cc", "-E", "-x", "assembler-with-cpp", "-D__ASSEMBLER__", "-I" + inc]
+            cmd += ["-I" + d for d in incdirs] + ["-D" + d for d in defines] + [mixer]
+            src = subprocess.check_output(cmd, text=True)
+        self.cpu = Cpu(Asm(src, addr), data_size=STACK_TOP + 1, flash_tables=flash)
+
+    def to_sim(self):
+        cpu = self.cpu
+        for name, size in self.state:
+            v = self.vars[name].value
+            if name in REGVARS:
+                reg, n = REGVARS[name]
+                for i in range(n):
+                    cpu.r[reg + i] = (v >> (8 * i)) & 0xFF
+            else:
+                for i in range(size):
+                    cpu.data[self.addr[name] + i] = (v >> (8 * i)) & 0xFF
+
+    def sim_value(self, name, size):
+        cpu = self.cpu
+        if name in REGVARS:
+            reg, n = REGVARS[name]
+            return sum(cpu.r[reg + i] << (8 * i) for i in range(n))
+        return sum(cpu.data[self.addr[name] + i] << (8 * i) for i in range(size))
+
+    def step(self, check=True):
+        """One sample on both sides; returns mixer.S's cycles."""
+        cpu = self.cpu
+        self.to_sim()
+        for r in SAVED:
+            cpu.r[r] = random.randrange(256)  # Whatever the interrupted code held
+        saved = list(cpu.r)
+        sreg = random.randrange(256)
+        cpu.set_sreg(sreg)
+        cpu.data[DATA_OCR1A] = 0
+        c0 = cpu.cycles
+        cpu.cycles += 6  # Interrupt response (4) + rjmp in the vector table (2)
+        cpu.run("__vector_10")
+        cycles = cpu.cycles - c0
+        self.lib.ref_isr()
+        if not check:
+            return cycles
+
+        bad = []
+        for name, size in self.state:
+            if self.sim_value(name, size) != self.vars[name].value:
+                bad.append("%s %#x (C %#x)" % (name, self.sim_value(name, size),
+                                                self.vars[name].value))
+        if cpu.data[DATA_OCR1A] != self.ocr1a.value:
+            bad.append("OCR1A %d (C %d)" % (cpu.data[DATA_OCR1A], self.ocr1a.value))
+        if cpu.sreg() != sreg:
+            bad.append("SREG %#x (was %#x)" % (cpu.sreg(), sreg))
+        for r in SAVED:
+            if cpu.r[r] != saved[r]:
+                bad.append("r%d %#x (was %#x)" % (r, cpu.r[r], saved[r]))
+        if cpu.sp != STACK_TOP:
+            bad.append("SP %#x" % cpu.sp)
+        if bad:
+            raise AssertionError(", ".join(bad))
+        return cycles
+
+    def fuzz(self):
+        for name, size in self.state:
+            if name not in FUZZ_KEEP and random.random() < 0.3:
+                self.vars[name].value = random.randrange(1 << (8 * size))
+        self.vars["voice_active"].value &= 0x3F
+        for v in VOICES:
+            self.vars[v + "_decay_log2"].value &= 3
+        svf_legal(self.vars)
+
+
+def svf_legal(v):
+    """Noise filter shifts within svf_coef's ranges (NOISE_SVF builds)."""
+    if "svf_shift" in v:
+        v["svf_shift"].value = random.randrange(1, 6)
+        v["svf_shift2"].value = random.randrange(3)
+
+
+def run_stream(h, n, fuzz):
+    worst = 0
+    for i in range(n):
+        r = random.random()
+        if r < 0.002:
+            h.lib.ref_trigger(random.randrange(6), random.randrange(65536))
+        elif r < 0.0025:
+            h.lib.ref_set_tone(random.randrange(470, 2001))
+        elif r < 0.003:
+            h.lib.ref_set_decay(random.randrange(256))
+            if random.random() < 0.3:
+                h.lib.ref_hihat_open(random.randrange(2))
+        if fuzz and random.random() < 0.3:
+            h.fuzz()
+        try:
+            worst = max(worst, h.step())
+        except AssertionError as e:
+            print("mixcheck: sample %d differs: %s" % (i, e))
+            return 1
+    print("mixcheck: %d samples match, worst %d cycles" % (n, worst))
+    return 0
+
+
+def table(h):
+    v = h.vars
+
+    def worst(setup, n=400):
+        w = 0
+        for _ in range(n):
+            for name, size in h.state:
+                if name not in FUZZ_KEEP:
+                    v[name].value = random.randrange(1 << (8 * size))
+            svf_legal(v)
+            setup()
+            w = max(w, h.step(check=False))
+        return w
+
+    def base(active, slot, due=True):
+        # Largest decay step due in the chosen slot (ctrl_slot advances first)
+        v["voice_active"].value = active
+        v["ctrl_slot"].value = (slot - 1) & 7
+        for p in VOICES:
+            v[p + "_decay"].value = 255
+            v[p + "_decay_log2"].value = 3
+            v[p + "_decay_acc"].value = 0xFF if due else 0
+        v["h_decay_speed"].value = 255
+        v["c_stutter"].value = 0
+        if "env_acc" in v:
+            v["env_acc"].value = 255
+
+    def kick_sweep():
+        base(0x01, 6)
+        v["k_step"].value = random.randrange(40000, 65536)
+
+    def tom_sweep():
+        base(0x10, 7)
+        v["t_step"].value = random.randrange(3000, 65536)
+
+    def both_sweeps():
+        base(0x11, 6)
+        v["k_step"].value = random.randrange(40000, 65536)
+        v["t_step"].value = random.randrange(3000, 65536)
+
+    def clap_burst(on):
+        base(0x08, 7)
+        v["c_stutter"].value = 2
+        v["c_stutter_timer"].value = random.randrange(59) if on else random.randrange(59, 300)
+
+    print("%-24s %6s" % ("path", "cycles"))
+    print("%-24s %6d" % ("idle", worst(lambda: base(0, 7))))
+    for i, name in enumerate(NAMES):
+        other = 1 if i != 1 else 0  # Someone else's envelope slot
+        print("%-24s %6d" % (name + " audio", worst(lambda: base(1 << i, other))))
+        print("%-24s %6d" % (name + " envelope slot", worst(lambda: base(1 << i, i))))
+    print("%-24s %6d" % ("kick sweep slot", worst(kick_sweep)))
+    print("%-24s %6d" % ("tom sweep slot", worst(tom_sweep)))
+    print("%-24s %6d" % ("kick + tom sweep slot", worst(both_sweeps)))
+    for slot in range(8):
+        print("%-24s %6d" % ("all six, slot %d" % slot, worst(lambda: base(0x3F, slot))))
+    print("%-24s %6d" % ("clap burst on", worst(lambda: clap_burst(True))))
+    print("%-24s %6d" % ("clap burst gap", worst(lambda: clap_burst(False))))
+    return 0
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__,
+                                 formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--lib", required=True, help="C mixer library (sim/mixref.c)")
+    ap.add_argument("--mixer", required=True, help="mixer.S")
+    ap.add_argument("-I", dest="incdirs", action="append", default=[], help="include directory")
+    ap.add_argument("-D", dest="defines", action="append", default=[],
+                    help="macro, as passed to the library build")
+    ap.add_argument("-n", "--samples", type=int, default=20000, help="samples (default 20000)")
+    ap.add_argument("--fuzz", action="store_true", help="scramble the state between samples")
+    ap.add_argument("--table", action="store_true", help="print the cycle table instead")
+    ap.add_argument("--seed", type=int, default=1, help="random seed (default 1)")
+    ap.add_argument("--listing", metavar="FILE",
+                    help="write mixer.S as an avr-objdump -d -l listing (for wcet.py) instead")
+    args = ap.parse_args()
+
+    random.seed(args.seed)
+    try:
+        h = Harness(args.lib, args.mixer, args.incdirs, args.defines)
+    except (OSError, subprocess.CalledProcessError, NotImplementedError, KeyError) as e:
+        print("mixcheck: %s" % e, file=sys.stderr)
+        return 2
+    if args.listing:
+        with open(args.listing, "w") as f:
+            f.write(h.cpu.asm.listing())
+        return 0
+    return table(h) if args.table else run_stream(h, args.samples, args.fuzz)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
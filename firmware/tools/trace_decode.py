@@ -0,0 +1,157 @@
+#!/usr/bin/env python3
+"""Decode a TinyTR sequencer trace capture (make TRACE=1).
+
+Capture the PB0 stream with any 3.3/5V USB-serial adapter at 500000 8N1:
+
+    stty -F /dev/ttyUSB0 500000 raw && cat /dev/ttyUSB0 > capture.bin
+    ./trace_decode.py capture.bin
+
+Prints a timeline and latency statistics between event pairs.
+Wire format and event IDs are defined in firmware/sequencer/trace.h.
+"""
+
+import argparse
+import sys
+
+# Event types (keep in sync with firmware/sequencer/trace.h)
+EVENTS = {
+    0x01: "STEP",
+    0x02: "TRIG",
+    0x03: "EE_START",
+    0x04: "EE_END",
+    0x05: "MODE",
+    0x06: "ADC_LATE",
+    0x07: "DROP",
+}
+EE_WHAT = {0: "pattern", 1: "bank", 2: "bpm", 3: "init", 4: "lfo"}
+MODES = {0: "Play", 1: "Bank", 2: "Tempo", 3: "LFO Rate", 4: "LFO Depth", 5: "Etc"}
+
+TS_UNITS_PER_MS = 8
+TS_WRAP = 1 << 14
+
+# Default pairs for latency statistics: (from, to, match on arg)
+DEFAULT_PAIRS = [
+    ("STEP", "STEP", False),       # Step period / jitter
+    ("STEP", "TRIG", False),       # Step to CV posted
+    ("EE_START", "EE_END", True),  # EEPROM write duration
+]
+
+
+def parse_records(data):
+    """Yield (type, arg, ts14) from the raw byte stream, resyncing on the top bit."""
+    i = 0
+    n = len(data)
+    while i < n:
+        if not data[i] & 0x80:
+            i += 1  # Mid-record (capture started late or byte lost)
+            continue
+        if i + 4 > n:
+            break
+        rec = data[i:i + 4]
+        if any(b & 0x80 for b in rec[1:]):
+            i += 1 + next(k for k, b in enumerate(rec[1:]) if b & 0x80)
+            continue
+        yield rec[0] & 0x7F, rec[1], rec[2] | (rec[3] << 7)
+        i += 4
+
+
+def unwrap(records):
+    """Turn 14-bit wrapping timestamps into monotonic milliseconds."""
+    base = 0
+    prev = None
+    for etype, arg, ts in records:
+        if prev is not None and ts < prev:
+            base += TS_WRAP
+        prev = ts
+        yield etype, arg, (base + ts) / TS_UNITS_PER_MS
+
+
+def describe(name, arg):
+    if name in ("EE_START", "EE_END"):
+        return EE_WHAT.get(arg, str(arg))
+    if name == "MODE":
+        return MODES.get(arg, str(arg))
+    if name == "ADC_LATE":
+        return "%d ms" % arg
+    if name == "DROP":
+        return "%d lost" % arg
+    return str(arg)
+
+
+def pair_latencies(events, start, end, match_arg):
+    """Latency from each `start` event to the next `end` event."""
+    out = []
+    pending = None
+    for name, arg, t in events:
+        if name == end and pending is not None:
+            if not match_arg or arg == pending[0]:
+                out.append(t - pending[1])
+                pending = None
+        if name == start:
+            pending = (arg, t)
+    return out
+
+
+def parse_pair(text):
+    match = text.endswith("=")
+    text = text.rstrip("=")
+    a, _, b = text.partition(":")
+    if a not in EVENTS.values() or b not in EVENTS.values():
+        raise argparse.ArgumentTypeError("unknown event in pair %r" % text)
+    return a, b, match
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__,
+                                 formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("capture", help="raw byte capture ('-' for stdin)")
+    ap.add_argument("--pair", action="append", type=parse_pair, metavar="FROM:TO[=]",
+                    help="latency pair, e.g. STEP:TRIG (trailing '=' matches args); "
+                         "repeatable, replaces the defaults")
+    ap.add_argument("--quiet", action="store_true", help="statistics only, no timeline")
+    args = ap.parse_args()
+
+    if args.capture == "-":
+        data = sys.stdin.buffer.read()
+    else:
+        with open(args.capture, "rb") as f:
+            data = f.read()
+
+    events = []
+    for etype, arg, t in unwrap(parse_records(data)):
+        events.append((EVENTS.get(etype, "0x%02X" % etype), arg, t))
+
+    if not events:
+        print("no events decoded", file=sys.stderr)
+        return 1
+
+    t0 = events[0][2]
+    if not args.quiet:
+        prev = t0
+        for name, arg, t in events:
+            print("%10.3f ms  +%8.3f  %-9s %s" % (t - t0, t - prev, name, describe(name, arg)))
+            prev = t
+        print()
+
+    counts = {}
+    for name, _, _ in events:
+        counts[name] = counts.get(name, 0) + 1
+    print("events: %d over %.1f ms" % (len(events), events[-1][2] - t0))
+    for name in sorted(counts):
+        print("  %-9s %d" % (name, counts[name]))
+    print()
+
+    print("%-22s %6s %9s %9s %9s" % ("latency (ms)", "n", "min", "avg", "max"))
+    for start, end, match in args.pair or DEFAULT_PAIRS:
+        lat = pair_latencies(events, start, end, match)
+        label = "%s -> %s" % (start, end)
+        if lat:
+            print("%-22s %6d %9.3f %9.3f %9.3f" % (label, len(lat), min(lat),
+                                                   sum(lat) / len(lat), max(lat)))
+        else:
+            print("%-22s %6d %9s %9s %9s" % (label, 0, "-", "-", "-"))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,582 @@
+#!/usr/bin/env python3
+"""Static worst-case cycle bound for a TinyTR interrupt handler.
+
+Disassembles the ELF (avr-objdump -d -l, so build with -g), follows the
+control-flow graph from the handler's entry through every branch, skip and
+rcall, and adds up AVRe cycle counts along the longest path. Run from the
+firmware Makefiles:
+
+    make -C firmware/synthesizer wcet     # mixer ISR vs the sample period
+    make -C firmware/sequencer wcet       # 1 ms tick vs the tick period
+
+Loops need a bound: a `// WCET: n` comment on a source line the loop's code
+comes from, or on the line above one. n is a C integer expression and may
+use the build's macros (--cc runs the compiler with -E -dM), e.g.
+
+    for (uint8_t k = 0; k < METAL_BITS; k++) {  // WCET: METAL_BITS
+
+n is the number of times the loop may branch back. libgcc's loops
+(__udivmodsi4, __mulhi3, ...) are bounded below. switch() jump tables
+through __tablejump2__ are read from the ELF; other indirect jumps and
+calls, recursion and loops without a bound are errors.
+
+The bound is per invocation: the 4-cycle interrupt response, the vector's
+rjmp and the handler to its reti. With --preempt, a handler that runs with
+interrupts enabled (ISR_NOBLOCK) is charged every invocation of the other
+handler that can land inside it. Exit status: 0 within --period, 1 over it,
+2 if the code could not be bounded.
+"""
+
+import argparse
+import os
+import re
+import shlex
+import subprocess
+import sys
+
+# ATtiny85 interrupt vectors (avr/iotn85.h)
+VECTORS = {
+    "INT0_vect": 1, "PCINT0_vect": 2, "TIMER1_COMPA_vect": 3, "TIMER1_OVF_vect": 4,
+    "TIMER0_OVF_vect": 5, "EE_RDY_vect": 6, "ANA_COMP_vect": 7, "ADC_vect": 8,
+    "TIMER1_COMPB_vect": 9, "TIMER0_COMPA_vect": 10, "TIMER0_COMPB_vect": 11,
+    "WDT_vect": 12, "USI_START_vect": 13, "USI_OVF_vect": 14,
+}
+RESPONSE = 4      # Interrupt response (push PC, clear I)
+VECTOR_JMP = 2    # rjmp in the vector table
+
+# AVRe cycle counts (ATtiny85 datasheet, Instruction Set Summary)
+CYCLES = {}
+for m in ("add adc sub subi sbc sbci and andi or ori eor com neg sbr cbr inc dec tst "
+          "clr ser cp cpc cpi mov movw ldi in out lsl lsr rol ror asr swap bset bclr "
+          "bst bld sec clc sen cln sez clz sei cli ses cls sev clv set clt seh clh "
+          "nop sleep wdr break").split():
+    CYCLES[m] = 1
+for m in "adiw sbiw ld ldd lds st std sts push pop cbi sbi rjmp ijmp".split():
+    CYCLES[m] = 2
+for m in "lpm rcall icall jmp".split():
+    CYCLES[m] = 3
+for m in "ret reti call".split():
+    CYCLES[m] = 4
+BRANCHES = set(("brbs brbc breq brne brcs brcc brsh brlo brmi brpl brge brlt brhs brhc "
+                "brts brtc brvs brvc brie brid").split())
+SKIPS = set("cpse sbrc sbrs sbic sbis".split())
+for m in BRANCHES | SKIPS:
+    CYCLES[m] = 1  # Not taken; the taken edge carries the rest
+
+# Back-edge bounds of libgcc's loops (avr/lib1funcs.S), by routine
+LIB_BOUNDS = {
+    "__udivmodqi4": 9, "__udivmodhi4": 17, "__udivmodsi4": 33, "__udivmodpsi4": 25,
+    "__mulqi3": 8, "__mulhi3": 16, "__mulpsi3": 24, "__mulsi3": 32,
+}
+TABLEJUMPS = ("__tablejump2__", "__tablejump__")
+
+
+class WcetError(Exception):
+    pass
+
+
+class Insn:
+    def __init__(self, addr, raw, mnem, ops, where):
+        self.addr = addr
+        self.raw = raw
+        self.size = len(raw)
+        self.mnem = mnem
+        self.ops = ops
+        self.where = where   # (file, line) or None
+
+    def target(self):
+        """Branch, jump or call target address."""
+        op = self.ops.split(",")[-1].strip()
+        if op.startswith("."):
+            return self.addr + self.size + int(op[1:], 0)
+        return int(op, 0)
+
+    def __str__(self):
+        return "0x%x %s %s" % (self.addr, self.mnem, self.ops)
+
+
+class Program:
+    """The .text of an avr-objdump -d -l listing."""
+
+    def __init__(self, listing):
+        self.insns = {}
+        self.flash = {}
+        self.symbols = {}   # name -> address
+        sym_re = re.compile(r"^([0-9a-f]+) <(.+)>:$")
+        line_re = re.compile(r"^(\S.*):(\d+)( \(discriminator \d+\))?$")
+        insn_re = re.compile(r"^\s*([0-9a-f]+):\t((?:[0-9a-f]{2} )+)\s*\t?([.\w]*)\s*([^;]*)")
+        where = None
+        for text in listing.splitlines():
+            m = insn_re.match(text)
+            if m:
+                addr = int(m.group(1), 16)
+                raw = bytes(int(b, 16) for b in m.group(2).split())
+                for i, b in enumerate(raw):
+                    self.flash[addr + i] = b
+                if m.group(3):
+                    self.insns[addr] = Insn(addr, raw, m.group(3), m.group(4).strip(), where)
+                continue
+            m = sym_re.match(text)
+            if m:
+                self.symbols[m.group(2)] = int(m.group(1), 16)
+                where = None
+                continue
+            m = line_re.match(text)
+            if m:
+                where = (m.group(1), int(m.group(2)))
+        self.names = sorted((a, n) for n, a in self.symbols.items())
+
+    def insn(self, addr):
+        if addr not in self.insns:
+            raise WcetError("no instruction at 0x%x" % addr)
+        return self.insns[addr]
+
+    def symbol_at(self, addr):
+        """Nearest symbol at or before addr."""
+        best = None
+        for a, n in self.names:
+            if a > addr:
+                break
+            best = n
+        return best
+
+    def word(self, addr):
+        return self.flash.get(addr, 0) | self.flash.get(addr + 1, 0) << 8
+
+
+class Macros:
+    """Integer macros of the build (compiler -E -dM) for bound expressions."""
+
+    def __init__(self, cc, src):
+        self.defs = {}
+        if not cc:
+            return
+        out = subprocess.check_output(shlex.split(cc) + ["-E", "-dM", src], text=True)
+        for line in out.splitlines():
+            m = re.match(r"#define (\w+) (.*)$", line)
+            if m:
+                self.defs[m.group(1)] = m.group(2)
+
+    def eval(self, expr, depth=0):
+        if depth > 16:
+            raise WcetError("macro nesting too deep in '%s'" % expr)
+        out = []
+        for tok in re.findall(r"0[xX][0-9a-fA-F]+|\d+|[A-Za-z_]\w*|<<|>>|[<>=!]=|\S", expr):
+            if re.match(r"[A-Za-z_]", tok):
+                if tok in ("U", "L", "UL", "LU", "ULL", "LL") and out and out[-1][0].isdigit():
+                    continue   # Integer suffix
+                if tok not in self.defs:
+                    raise WcetError("'%s' in '%s' is not an integer macro" % (tok, expr))
+                out.append("(%d)" % self.eval(self.defs[tok], depth + 1))
+            elif tok == "/":
+                out.append("//")
+            elif re.match(r"[0-9()+\-*%<>&|^~]|[=!]=", tok):
+                out.append(tok)
+            else:
+                raise WcetError("cannot evaluate '%s'" % expr)
+        expr_py = re.sub(r"(\d)([uUlL]+)", r"\1", " ".join(out))
+        try:
+            return int(eval(expr_py, {"__builtins__": {}}))
+        except Exception:
+            raise WcetError("cannot evaluate '%s'" % expr)
+
+
+class Annotations:
+    """`WCET: n` comments in the sources named by the line info."""
+
+    def __init__(self, macros, srcdir):
+        self.macros = macros
+        self.srcdir = srcdir
+        self.files = {}
+
+    def lines(self, path):
+        if path not in self.files:
+            full = path if os.path.isabs(path) else os.path.join(self.srcdir, path)
+            try:
+                with open(full) as f:
+                    self.files[path] = f.read().splitlines()
+            except OSError:
+                self.files[path] = []
+        return self.files[path]
+
+    def bound(self, where):
+        """Bound annotated on a source line or the line above, or None."""
+        path, line = where
+        text = self.lines(path)
+        for n in (line, line - 1):
+            if 1 <= n <= len(text):
+                m = re.search(r"WCET:\s*(.+?)\s*(\*/)?\s*$", text[n - 1])
+                if m:
+                    return self.macros.eval(m.group(1))
+        return None
+
+
+def where_str(where):
+    return "%s:%d" % (os.path.basename(where[0]), where[1]) if where else "?"
+
+
+class Analysis:
+    def __init__(self, prog, notes):
+        self.prog = prog
+        self.notes = notes
+        self.funcs = {}      # entry -> bound
+        self.active = []
+        self.loops = []      # (function, location, bound, cycles per pass, total)
+        self.calls = {}      # name -> bound
+
+    # --- Control-flow graph ---
+    def tablejump(self, insn):
+        """Targets and dispatch cost of a switch through __tablejump2__."""
+        prog = self.prog
+        lo = hi = limit = None
+        addr = insn.addr
+        for _ in range(12):
+            prev = [a for a in (addr - 2, addr - 4) if a in prog.insns and
+                    prog.insns[a].addr + prog.insns[a].size == addr]
+            if not prev:
+                break
+            addr = prev[0]
+            p = prog.insns[addr]
+            ops = [o.strip() for o in p.ops.split(",")]
+            if p.mnem == "subi" and ops[0] == "r30" and lo is None:
+                lo = int(ops[1], 0)
+            elif p.mnem == "sbci" and ops[0] == "r31" and hi is None:
+                hi = int(ops[1], 0)
+            elif p.mnem == "cpi" and limit is None:
+                limit = int(ops[1], 0)
+        if lo is None or hi is None:
+            raise WcetError("jump table base not found before %s" % insn)
+        base = (-(hi << 8 | lo) & 0xFFFF) * 2
+        if insn.target() == prog.symbols.get("__tablejump2__"):
+            pass
+        else:
+            raise WcetError("only __tablejump2__ tables are supported: %s" % insn)
+        targets = []
+        for i in range(limit if limit else 256):
+            t = prog.word(base + 2 * i) * 2
+            if t not in prog.insns:
+                if limit:
+                    raise WcetError("jump table entry %d at 0x%x is not code" % (i, base + 2 * i))
+                break
+            targets.append(t)
+        if not targets:
+            raise WcetError("empty jump table for %s" % insn)
+        # Dispatch: the rjmp, then __tablejump2__ up to its ijmp
+        cost = CYCLES[insn.mnem]
+        a = insn.target()
+        while True:
+            d = prog.insn(a)
+            cost += CYCLES[d.mnem]
+            if d.mnem in ("ijmp", "ret"):
+                break
+            a += d.size
+        return targets, cost
+
+    def successors(self, insn):
+        """(cycles, [(successor, extra cycles)]) of one instruction."""
+        m = insn.mnem
+        nxt = insn.addr + insn.size
+        if m not in CYCLES:
+            raise WcetError("unknown instruction %s" % insn)
+        if m in ("ret", "reti"):
+            return CYCLES[m], []
+        if m in BRANCHES:
+            return 1, [(nxt, 0), (insn.target(), 1)]
+        if m in SKIPS:
+            skipped = self.prog.insn(nxt)
+            return 1, [(nxt, 0), (nxt + skipped.size, skipped.size // 2)]
+        if m in ("rjmp", "jmp"):
+            t = insn.target()
+            if self.prog.symbol_at(t) in TABLEJUMPS and self.prog.symbols.get(
+                    self.prog.symbol_at(t)) == t:
+                targets, cost = self.tablejump(insn)
+                return cost, [(x, 0) for x in targets]
+            return CYCLES[m], [(t, 0)]
+        if m in ("rcall", "call"):
+            t = insn.target()
+            if t == nxt:
+                return CYCLES[m], [(nxt, 0)]   # rcall .+0: a stack frame push
+            return CYCLES[m] + self.function(t), [(nxt, 0)]
+        if m in ("ijmp", "icall"):
+            raise WcetError("indirect %s cannot be bounded: %s" % (m, insn))
+        return CYCLES[m], [(nxt, 0)]
+
+    # --- Bounds ---
+    def function(self, entry):
+        """Cycles from entry to its ret/reti, calls included."""
+        if entry in self.funcs:
+            return self.funcs[entry]
+        name = self.prog.symbol_at(entry) or "0x%x" % entry
+        if entry in self.active:
+            raise WcetError("recursion through %s" % name)
+        self.active.append(entry)
+        bound = self.region(entry, name)
+        self.active.pop()
+        self.funcs[entry] = bound
+        if self.active:
+            self.calls[name] = bound
+        return bound
+
+    def region(self, entry, name):
+        # Instruction-level graph from the entry
+        cost, succ = {}, {}
+        todo = [entry]
+        while todo:
+            a = todo.pop()
+            if a in cost:
+                continue
+            c, s = self.successors(self.prog.insn(a))
+            cost[a], succ[a] = c, s
+            todo.extend(t for t, _ in s)
+        nodes = list(cost)
+        preds = {a: [] for a in nodes}
+        for a in nodes:
+            for t, _ in succ[a]:
+                preds[t].append(a)
+
+        # Dominators, then back edges (a DFS edge to a node on the stack)
+        order = self.postorder(entry, succ)
+        rpo = order[::-1]
+        index = {a: i for i, a in enumerate(rpo)}
+        idom = {entry: entry}
+        changed = True
+        while changed:
+            changed = False
+            for a in rpo[1:]:
+                ps = [p for p in preds[a] if p in idom]
+                new = ps[0]
+                for p in ps[1:]:
+                    x, y = new, p
+                    while x != y:
+                        while index[x] > index[y]:
+                            x = idom[x]
+                        while index[y] > index[x]:
+                            y = idom[y]
+                    new = x
+                if idom.get(a) != new:
+                    idom[a] = new
+                    changed = True
+
+        def dominates(h, a):
+            while a != h:
+                if a == entry:
+                    return False
+                a = idom[a]
+            return True
+
+        headers = {}
+        for a in nodes:
+            for t, _ in succ[a]:
+                if index[t] <= index[a]:
+                    if not dominates(t, a):
+                        raise WcetError("irreducible loop into 0x%x in %s" % (t, name))
+                    headers.setdefault(t, []).append(a)
+
+        # Natural loops, innermost first
+        loops = []
+        for h, latches in headers.items():
+            body = {h}
+            stack = list(latches)
+            while stack:
+                a = stack.pop()
+                if a not in body:
+                    body.add(a)
+                    stack.extend(preds[a])
+            loops.append((h, body))
+        loops.sort(key=lambda l: len(l[1]))
+
+        # Collapse each loop into one node: bound x (longest pass) + longest exit
+        rep = {a: a for a in nodes}
+        node_cost = dict(cost)
+        node_succ = {a: list(s) for a, s in succ.items()}
+
+        def find(a):
+            while rep[a] != a:
+                a = rep[a]
+            return a
+
+        for h, body in loops:
+            members = set(find(a) for a in body)
+            own = [a for a in body if find(a) == a]
+            n = self.loop_bound(name, h, own)
+            dist = self.longest(h, members, node_cost, node_succ, find, skip=h)
+            per_pass, exit_cost = None, None
+            for a in members:
+                if a not in dist:
+                    continue
+                for t, extra in node_succ[a]:
+                    r = find(t)
+                    if r == h:
+                        v = dist[a] + extra
+                        per_pass = v if per_pass is None or v > per_pass else per_pass
+                    elif r not in members:
+                        v = dist[a] + extra
+                        exit_cost = v if exit_cost is None or v > exit_cost else exit_cost
+            if exit_cost is None:
+                raise WcetError("loop at 0x%x in %s never exits" % (h, name))
+            total = n * per_pass + exit_cost
+            self.loops.append((name, self.loop_where(own), n, per_pass, total))
+            exits = [(t, 0) for a in members for t, _ in node_succ[a] if find(t) not in members]
+            for a in members:
+                rep[a] = h
+            rep[h] = h
+            node_cost[h] = total
+            node_succ[h] = exits
+
+        dist = self.longest(entry, set(find(a) for a in nodes), node_cost, node_succ, find)
+        ends = [dist[a] for a in dist if not node_succ[a]]
+        if not ends:
+            raise WcetError("%s never returns" % name)
+        return max(ends)
+
+    @staticmethod
+    def postorder(entry, succ):
+        seen, order = {entry}, []
+        stack = [(entry, iter(succ[entry]))]
+        while stack:
+            a, it = stack[-1]
+            for t, _ in it:
+                if t not in seen:
+                    seen.add(t)
+                    stack.append((t, iter(succ[t])))
+                    break
+            else:
+                order.append(a)
+                stack.pop()
+        return order
+
+    @staticmethod
+    def longest(start, members, node_cost, node_succ, find, skip=None):
+        """Longest path costs from start over acyclic members (edges to skip cut)."""
+        indeg = {a: 0 for a in members}
+        for a in members:
+            for t, _ in node_succ[a]:
+                r = find(t)
+                if r in members and r != skip and r != a:
+                    indeg[r] += 1
+        dist = {start: node_cost[start]}
+        ready = [a for a in members if indeg[a] == 0]
+        done = 0
+        while ready:
+            a = ready.pop()
+            done += 1
+            for t, extra in node_succ[a]:
+                r = find(t)
+                if r not in members or r == skip or r == a:
+                    continue
+                if a in dist:
+                    v = dist[a] + extra + node_cost[r]
+                    if v > dist.get(r, -1):
+                        dist[r] = v
+                indeg[r] -= 1
+                if indeg[r] == 0:
+                    ready.append(r)
+        if done != len(members):
+            raise WcetError("cycle left after loop collapsing near 0x%x" % start)
+        return dist
+
+    def loop_bound(self, name, header, own):
+        lib = self.prog.symbol_at(header) or ""
+        for routine, n in LIB_BOUNDS.items():
+            if lib.startswith(routine):
+                return n
+        found = []
+        for a in sorted(own):
+            where = self.prog.insns[a].where
+            if where:
+                n = self.notes.bound(where)
+                if n is not None:
+                    found.append(n)
+        if not found:
+            raise WcetError("loop at 0x%x (%s, %s) has no bound: add a `// WCET: n` comment"
+                            % (header, name, self.loop_where(own)))
+        return max(found)
+
+    def loop_where(self, own):
+        wheres = sorted(set(self.prog.insns[a].where for a in own if self.prog.insns[a].where))
+        return ", ".join(where_str(w) for w in wheres[:2]) or "0x%x" % min(own)
+
+
+def vector_symbol(name):
+    if name.startswith("__vector_"):
+        return name
+    if name not in VECTORS:
+        raise WcetError("unknown vector %s" % name)
+    return "__vector_%d" % VECTORS[name]
+
+
+def isr_bound(analysis, prog, name):
+    sym = vector_symbol(name)
+    if sym not in prog.symbols:
+        raise WcetError("%s (%s) not in the ELF" % (name, sym))
+    return RESPONSE + VECTOR_JMP + analysis.function(prog.symbols[sym])
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__,
+                                 formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("elf", nargs="?", help="firmware ELF (built with -g)")
+    ap.add_argument("--listing", help="avr-objdump -d -l output instead of the ELF")
+    ap.add_argument("--objdump", default="avr-objdump", help="avr-objdump binary")
+    ap.add_argument("--isr", default="TIMER0_COMPA_vect", help="handler to bound")
+    ap.add_argument("--period", required=True,
+                    help="cycles between invocations (an expression of the build's macros)")
+    ap.add_argument("--preempt", metavar="VECTOR=PERIOD", action="append", default=[],
+                    help="handler that can interrupt --isr, and its period in cycles")
+    ap.add_argument("--cc", help="compiler command line of the build, for macros")
+    ap.add_argument("--src", default="main.c", help="source file for --cc (default main.c)")
+    ap.add_argument("-v", "--verbose", action="store_true", help="list loops and calls")
+    args = ap.parse_args()
+
+    try:
+        if args.listing:
+            with open(args.listing) as f:
+                listing = f.read()
+        elif args.elf:
+            listing = subprocess.check_output([args.objdump, "-d", "-l", args.elf], text=True)
+        else:
+            ap.error("an ELF or --listing is required")
+        prog = Program(listing)
+        macros = Macros(args.cc, args.src)
+        notes = Annotations(macros, os.path.dirname(os.path.abspath(args.src)))
+        analysis = Analysis(prog, notes)
+
+        period = macros.eval(args.period)
+        bound = isr_bound(analysis, prog, args.isr)
+        print("%s: %d cycles worst case, period %d (%d%%)"
+              % (args.isr, bound, period, 100 * bound // period))
+
+        # Response time with the preempting handlers' invocations inside it
+        total = bound
+        for p in args.preempt:
+            vec, _, expr = p.partition("=")
+            c, t = isr_bound(analysis, prog, vec), macros.eval(expr)
+            print("  %s: %d cycles every %d" % (vec, c, t))
+        if args.preempt:
+            others = [(isr_bound(analysis, prog, v), macros.eval(e))
+                      for v, _, e in (p.partition("=") for p in args.preempt)]
+            while total <= period:
+                nxt = bound + sum(-(-total // t) * c for c, t in others)
+                if nxt == total:
+                    break
+                total = nxt
+            print("  with preemption: %d cycles (%d%%)" % (total, 100 * total // period))
+
+        if args.verbose:
+            for func, where, n, per_pass, cycles in analysis.loops:
+                print("  loop %-24s %-26s x%-3d %4d/pass %5d" % (func, where, n, per_pass, cycles))
+            for func, cycles in sorted(analysis.calls.items()):
+                print("  call %-51s %5d" % (func, cycles))
+    except (WcetError, subprocess.CalledProcessError, OSError) as e:
+        print("wcet: %s" % e, file=sys.stderr)
+        return 2
+
+    if total > period:
+        print("wcet: %s can overrun its period by %d cycles" % (args.isr, total - period),
+              file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())